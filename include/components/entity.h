@@ -417,6 +417,10 @@ public:
 	Model* pModel = nullptr;
 	std::unique_ptr<AABB> boundingVolume;
 
+	// Model matrix of the previous frame, for the velocity the G-buffer writes
+	glm::mat4 prevModelMatrix{ 1.f };
+	bool prevModelMatrixValid = false;
+
 	char entityName[128] = "New Element";
 
 	Entity() {
@@ -431,11 +435,13 @@ public:
 	}
 
 	// constructor, expects a filepath to a 3D model.
+	// If the model is still streaming in, the bounding volume is generated on the first draw after it finished loading
 	Entity(Model& model) : pModel{ &model }
 	{
 		id = counter + 1;
 		counter++;
-		boundingVolume = std::make_unique<AABB>(generateAABB(model));
+		if (model.isLoaded)
+			boundingVolume = std::make_unique<AABB>(generateAABB(model));
 		//boundingVolume = std::make_unique<Sphere>(generateSphereBV(model));
 	}
 
@@ -445,7 +451,8 @@ public:
 		id = counter + 1;
 		counter++;
 		strcpy(entityName, name);
-		boundingVolume = std::make_unique<AABB>(generateAABB(model));
+		if (model.isLoaded)
+			boundingVolume = std::make_unique<AABB>(generateAABB(model));
 		//boundingVolume = std::make_unique<Sphere>(generateSphereBV(model));
 	}
 
@@ -462,6 +469,14 @@ public:
 
 	AABB getGlobalAABB()
 	{
+		// bounding volume is created once the model has streamed in, empty box at the entity until then
+		if (!boundingVolume)
+		{
+			if (pModel == nullptr || !pModel->isLoaded)
+				return AABB(transform.getGlobalPosition(), 0.f, 0.f, 0.f);
+			boundingVolume = std::make_unique<AABB>(generateAABB(*pModel));
+		}
+
 		//Get global scale thanks to our transform
 		const glm::vec3 globalCenter{ transform.getModelMatrix() * glm::vec4(boundingVolume->center, 1.f) };
 
@@ -542,12 +557,29 @@ public:
 		else
 			total++;
 
+		if (!pModel->isLoaded)		// Model still streaming in, nothing to draw yet
+			return;
+
+		if (!boundingVolume)
+			boundingVolume = std::make_unique<AABB>(generateAABB(*pModel));
+
+		// kept up to date for culled entities too, so one coming back into view has no stale motion
+		const glm::mat4& modelMatrix = transform.getModelMatrix();
+		if (!prevModelMatrixValid)
+		{
+			prevModelMatrix = modelMatrix;
+			prevModelMatrixValid = true;
+		}
+
 		if (boundingVolume->isOnFrustum(frustum, transform))
 		{
-			ourShader.setMat4("model", transform.getModelMatrix());
+			ourShader.setMat4("model", modelMatrix);
+			ourShader.setMat4("prevModel", prevModelMatrix);
 			pModel->Draw(ourShader);
 			display++;
 		}
+
+		prevModelMatrix = modelMatrix;
 	}
 
 	void drawPointLights(Shader& shader, unsigned int& total, Camera& camera)
@@ -8,6 +8,8 @@
 
 #include <components/shader_m.h>
 
+#include "textureCache.h"
+
 #include <string>
 #include <vector>
 using namespace std;
@@ -35,6 +37,7 @@ struct MeshTexture {
     unsigned int id;
     string type;
     string path;
+    TextureHandle handle;   // keeps the shared texture alive in the TextureCache
 };
 
 class Mesh {
@@ -43,17 +46,26 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<MeshTexture>      textures;
-    unsigned int VAO;
+    unsigned int VAO = 0;
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<MeshTexture> textures)
+    // uploadNow = false only keeps the CPU data, so that meshes can be built on a worker thread and uploaded later with uploadMesh()
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<MeshTexture> textures, bool uploadNow = true)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        if (uploadNow)
+            setupMesh();
+    }
+
+    // creates the GPU buffers of a mesh built with uploadNow = false (render thread only)
+    void uploadMesh()
+    {
+        if (VAO == 0)
+            setupMesh();
     }
 
     // render the mesh
@@ -13,16 +13,36 @@
 #include <components/mesh.h>
 #include <components/shader_m.h>
 
+#include "image.h"
+#include "textureCache.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
+#include <memory>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// CPU side result of parsing a model file. Built on a worker thread without any GL call,
+// then uploaded piece by piece on the render thread (see Model::uploadNext).
+struct ModelData
+{
+    string directory;
+    vector<Mesh> meshes;                        // geometry only, GPU buffers are not created yet
+    vector<shared_ptr<ImageData>> images;       // decoded textures that were not resident yet when the file was parsed
+    vector<string> imageTextures;               // MeshTexture::path of each decoded image
+    vector<MeshTexture> textures;               // every texture of the model, ids are filled in during the upload
+    map<string, TextureHandle> textureHandles;  // MeshTexture::path -> shared texture
+    unsigned int uploadedImages = 0;
+    unsigned int uploadedMeshes = 0;
+    bool valid = false;
+};
+
 class Model 
 {
 public:
@@ -31,6 +51,7 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    bool isLoaded = false;                  // true once every mesh and texture is on the GPU
 
     Model(){}
 
@@ -43,16 +64,19 @@ public:
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        if (!isLoaded)
+            return;
+
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
-    
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    // parses the file and decodes its textures. Thread safe, does not touch OpenGL.
+    static ModelData parseModel(string const &path)
     {
-        // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-        //stbi_set_flip_vertically_on_load(false);
+        Model parser;
+        ModelData data;
+
         // read file via ASSIMP
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -60,13 +84,78 @@ private:
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return data;
         }
         // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        parser.directory = path.substr(0, path.find_last_of('/'));
+        parser.pendingData = &data;
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        parser.processNode(scene->mRootNode, scene);
+
+        data.directory = parser.directory;
+        data.meshes = std::move(parser.meshes);
+        data.textures = std::move(parser.textures_loaded);
+        data.valid = true;
+        return data;
+    }
+
+    // uploads the next texture or mesh of the parsed data (render thread only).
+    // returns false once everything is on the GPU and the model is ready to be drawn.
+    bool uploadNext(ModelData& data)
+    {
+        if (data.uploadedImages < data.images.size())
+        {
+            shared_ptr<ImageData>& image = data.images[data.uploadedImages];
+            data.textureHandles[data.imageTextures[data.uploadedImages++]] = TextureCache::instance().acquire(image);
+            image.reset();      // the streamer keeps the CPU copy until the last mip is on the GPU
+            return true;
+        }
+
+        if (data.uploadedMeshes < data.meshes.size())
+        {
+            Mesh& mesh = data.meshes[data.uploadedMeshes++];
+            for (auto& texture : mesh.textures)
+                setTextureHandle(texture, data.textureHandles[texture.path]);
+            mesh.uploadMesh();
+            meshes.push_back(std::move(mesh));
+            return true;
+        }
+
+        textures_loaded = data.textures;
+        for (auto& texture : textures_loaded)
+            setTextureHandle(texture, data.textureHandles[texture.path]);
+
+        isLoaded = data.valid;
+        return false;
+    }
+
+    // starts a progressive load: the model stays empty (and is not drawn) until uploadNext returns false
+    void beginUpload(ModelData& data)
+    {
+        meshes.clear();
+        textures_loaded.clear();
+        texturesLoadedIndex.clear();
+        directory = data.directory;
+        isLoaded = false;
+    }
+    
+private:
+    ModelData* pendingData = nullptr;                       // where processMesh stores the decoded images while parsing
+    unordered_map<string, unsigned int> texturesLoadedIndex;  // path -> index in textures_loaded
+
+    static void setTextureHandle(MeshTexture& texture, const TextureHandle& handle)
+    {
+        texture.handle = handle;
+        texture.id = handle ? handle->id : 0;
+    }
+
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    void loadModel(string const &path)
+    {
+        ModelData data = parseModel(path);
+        beginUpload(data);
+        while (uploadNext(data));
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -156,28 +245,28 @@ private:
         // normal: texture_normalN
 
         // 1. albedo maps
-        vector<MeshTexture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texAlbedo");
+        vector<MeshTexture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texAlbedo", TextureUsage::Color);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. normal maps
-        std::vector<MeshTexture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texNormal");
+        std::vector<MeshTexture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texNormal", TextureUsage::Normal);
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 3. roughness maps
-        vector<MeshTexture> roughnessMaps = loadMaterialTextures(material, aiTextureType_SHININESS, "texRoughness");
+        vector<MeshTexture> roughnessMaps = loadMaterialTextures(material, aiTextureType_SHININESS, "texRoughness", TextureUsage::Mask);
         textures.insert(textures.end(), roughnessMaps.begin(), roughnessMaps.end());
         // 4. metalness maps
-        std::vector<MeshTexture> metalnessMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texMetalness");
+        std::vector<MeshTexture> metalnessMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texMetalness", TextureUsage::Mask);
         textures.insert(textures.end(), metalnessMaps.begin(), metalnessMaps.end());
         // 4. ao maps
-        std::vector<MeshTexture> aoMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texAO");
+        std::vector<MeshTexture> aoMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texAO", TextureUsage::Mask);
         textures.insert(textures.end(), aoMaps.begin(), aoMaps.end());
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return a mesh object created from the extracted mesh data, GPU buffers are created later by uploadNext
+        return Mesh(vertices, indices, textures, false);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<MeshTexture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // the required info is returned as a Texture struct. The usage comes from the slot, whatever the file is named.
+    vector<MeshTexture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, TextureUsage usage)
     {
         vector<MeshTexture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
@@ -185,24 +274,29 @@ private:
             aiString str;
             mat->GetTexture(type, i, &str);
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            auto loaded = texturesLoadedIndex.find(str.C_Str());
+            if(loaded != texturesLoadedIndex.end())
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
+                textures.push_back(textures_loaded[loaded->second]);
+                continue;
             }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                MeshTexture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+
+            MeshTexture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+            texturesLoadedIndex[texture.path] = (unsigned int)textures_loaded.size();
+            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+
+            // another model may already own this file on the GPU, hold on to it instead of decoding it again
+            string filename = this->directory + '/' + texture.path;
+            if (TextureHandle resident = TextureCache::instance().find(filename, usage))
+                pendingData->textureHandles[texture.path] = resident;
+            else
+            {
+                pendingData->images.push_back(TextureCache::instance().decode(filename, usage));
+                pendingData->imageTextures.push_back(texture.path);
             }
         }
         return textures;
@@ -215,38 +309,11 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
+    ImageData image;
+    if (!loadImageData(filename, image))
         std::cout << "MeshTexture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    buildImageMips(image);
 
-    return textureID;
+    return uploadImageData(image);
 }
 #endif
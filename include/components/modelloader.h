@@ -0,0 +1,85 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <components/model.h>
+#include <components/threadpool.h>
+
+#include <string>
+#include <list>
+#include <future>
+#include <chrono>
+#include <iostream>
+
+// Streams models in the background: files are parsed and their textures decoded on worker threads,
+// then update() uploads the results on the render thread under a per-frame time budget.
+// A model is not drawn until its last mesh is on the GPU (Model::isLoaded).
+class ModelLoader
+{
+public:
+    ModelLoader(ThreadPool& pool = ThreadPool::shared()) : pool(pool) {}
+
+    // queues a model file, the model object must outlive the load
+    void load(Model& model, const std::string& path, const std::string& name)
+    {
+        LoadRequest request;
+        request.model = &model;
+        request.name = name;
+        request.parsed = pool.submit([path] { return Model::parseModel(path); });
+        requests.push_back(std::move(request));
+    }
+
+    // uploads finished models until budgetMs is spent, call once per frame from the render thread
+    void update(float budgetMs)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto elapsedMs = [&start] { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+        for (auto it = requests.begin(); it != requests.end() && elapsedMs() < budgetMs; )
+        {
+            LoadRequest& request = *it;
+
+            if (!request.uploading)
+            {
+                if (request.parsed.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    ++it;
+                    continue;
+                }
+
+                request.data = request.parsed.get();
+                request.model->beginUpload(request.data);
+                request.uploading = true;
+            }
+
+            bool remainingWork = true;
+            while (remainingWork && elapsedMs() < budgetMs)
+                remainingWork = request.model->uploadNext(request.data);
+
+            if (remainingWork)
+                break;
+
+            std::cout << request.name << " Model Loaded\n";
+            it = requests.erase(it);
+        }
+    }
+
+    unsigned int pendingCount() const
+    {
+        return (unsigned int)requests.size();
+    }
+
+private:
+    struct LoadRequest
+    {
+        Model* model = nullptr;
+        std::string name;
+        std::future<ModelData> parsed;
+        ModelData data;
+        bool uploading = false;
+    };
+
+    ThreadPool& pool;
+    std::list<LoadRequest> requests;
+};
+
+#endif
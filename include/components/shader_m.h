@@ -127,6 +127,36 @@ public:
         glDeleteShader(fragment);
 
     }
+    // vertex, geometry and fragment shaders, for the passes that route their primitives to several layers
+    // ------------------------------------------------------------------------
+    void setShader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
+    {
+        unsigned int vertex = compileShader(GL_VERTEX_SHADER, readShaderFile(vertexPath), "VERTEX");
+        unsigned int geometry = compileShader(GL_GEOMETRY_SHADER, readShaderFile(geometryPath), "GEOMETRY");
+        unsigned int fragment = compileShader(GL_FRAGMENT_SHADER, readShaderFile(fragmentPath), "FRAGMENT");
+        // shader Program
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, geometry);
+        glAttachShader(ID, fragment);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(vertex);
+        glDeleteShader(geometry);
+        glDeleteShader(fragment);
+    }
+    // compute shader program, needs a GL 4.3 context (GLAD_GL_VERSION_4_3)
+    // ------------------------------------------------------------------------
+    void setComputeShader(const char* computePath)
+    {
+        unsigned int compute = compileShader(GL_COMPUTE_SHADER, readShaderFile(computePath), "COMPUTE");
+        // shader Program
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(compute);
+    }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
@@ -193,6 +223,33 @@ public:
     }
 
 private:
+    std::string readShaderFile(const char* path)
+    {
+        std::ifstream shaderFile;
+        shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            shaderFile.open(path);
+            std::stringstream shaderStream;
+            shaderStream << shaderFile.rdbuf();
+            return shaderStream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << " " << e.what() << std::endl;
+        }
+        return std::string();
+    }
+    // ------------------------------------------------------------------------
+    unsigned int compileShader(GLenum type, const std::string& code, std::string typeName)
+    {
+        const char* shaderCode = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &shaderCode, NULL);
+        glCompileShader(shader);
+        checkCompileErrors(shader, typeName);
+        return shader;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,155 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <queue>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+
+// Fixed size pool of worker threads for CPU side work (file parsing, image decoding, ...).
+// Jobs must never touch OpenGL, the context only lives on the render thread.
+class ThreadPool
+{
+public:
+    ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            unsigned int cores = std::thread::hardware_concurrency();
+            threadCount = cores > 1 ? cores - 1 : 1;   // keep one core for the render thread
+        }
+
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        stop();
+    }
+
+    // drops the queued jobs (their futures report a broken promise) and joins the workers once the running ones return.
+    // Call it before the singletons the jobs use go away, the static destruction order does not guarantee it
+    void stop()
+    {
+        std::queue<std::function<void()>> dropped;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            stopping = true;
+            std::swap(dropped, jobs);
+        }
+        queueCondition.notify_all();
+        for (auto& worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queues a job and returns a future holding its result
+    template<typename F>
+    auto submit(F&& job) -> std::future<decltype(job())>
+    {
+        using Result = decltype(job());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            if (!stopping)
+            {
+                jobs.emplace([task] { (*task)(); });
+                queueCondition.notify_one();
+                return result;
+            }
+        }
+        (*task)();      // no workers left after stop(), runs on the caller
+        return result;
+    }
+
+    // runs job(i) for i in [0, count) on the workers and the calling thread, returns once every index is done.
+    // Safe to call from a job: the caller keeps claiming indices itself, so it never waits on a queued helper.
+    template<typename F>
+    void parallelFor(unsigned int count, F job)
+    {
+        struct Shared
+        {
+            std::atomic<unsigned int> next{0};
+            std::atomic<unsigned int> done{0};
+            std::mutex doneMutex;
+            std::condition_variable doneCondition;
+        };
+        auto shared = std::make_shared<Shared>();
+        auto run = [shared, count, &job]
+        {
+            for (unsigned int i = shared->next++; i < count; i = shared->next++)
+            {
+                job(i);
+                if (++shared->done == count)
+                {
+                    std::unique_lock<std::mutex> lock(shared->doneMutex);
+                    shared->doneCondition.notify_all();
+                }
+            }
+        };
+
+        unsigned int helpers = std::min(count, size() + 1) - 1;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            for (unsigned int i = 0; i < helpers && !stopping; i++)
+                jobs.emplace(run);
+        }
+        queueCondition.notify_all();
+
+        run();
+
+        std::unique_lock<std::mutex> lock(shared->doneMutex);
+        shared->doneCondition.wait(lock, [&shared, count] { return shared->done == count; });
+    }
+
+    unsigned int size() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    // process wide pool shared by all the loaders
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+};
+
+#endif
@@ -27,11 +27,13 @@ vec3 computeTexNormal(vec3 viewNormal, vec3 texNormal);
 
 void main()
 {
-    vec3 texNormal = normalize(texture(texNormal, TexCoords).rgb * 2.0f - 1.0f);
+    vec2 texNormalXY = texture(texNormal, TexCoords).rg * 2.0f - 1.0f;    // BC5 normal maps only store x and y
+    vec3 texNormal = normalize(vec3(texNormalXY, sqrt(max(1.0f - dot(texNormalXY, texNormalXY), 0.0f))));
     texNormal.g = -texNormal.g;   // In case the normal map was made with DX3D coordinates system in mind
 
+    // a vertex behind the previous camera has no meaningful previous position, no motion rather than a huge one
     vec2 fragPosA = (fragPosition.xy / fragPosition.w) * 0.5f + 0.5f;
-    vec2 fragPosB = (fragPrevPosition.xy / fragPrevPosition.w) * 0.5f + 0.5f;
+    vec2 fragPosB = fragPrevPosition.w > 0.0f ? (fragPrevPosition.xy / fragPrevPosition.w) * 0.5f + 0.5f : fragPosA;
 
     gPosition = vec4(viewPos, LinearizeDepth(gl_FragCoord.z));
     gAlbedo.rgb = vec3(texture(texAlbedo, TexCoords));
@@ -13,6 +13,8 @@ out vec4 fragPrevPosition;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform mat4 prevModel;             // model matrix of the entity last frame
+uniform mat4 prevViewProjection;    // camera of the last frame
 
 
 void main()
@@ -28,6 +30,10 @@ void main()
 
     gl_Position = projection * viewFragPos;
 
+    // Clip space positions of this frame and the previous one, divided per fragment for the velocity
+    fragPosition = gl_Position;
+    fragPrevPosition = prevViewProjection * prevModel * vec4(position, 1.0f);
+
 
     // World Space
 //    worldPos = vec3(model * vec4(position, 1.0f));
@@ -0,0 +1,72 @@
+#version 400 core
+
+// Compact G-buffer layout (gBufferCompactMode), 14 bytes per pixel instead of 28 for gBuffer.frag. The position is
+// not stored, the lighting reconstructs it from the depth buffer
+layout (location = 0) out vec4 gAlbedo;         // RGBA8, albedo + roughness
+layout (location = 1) out vec2 gNormal;         // RG16, octahedral view space normal
+layout (location = 2) out vec2 gMaterial;       // RG8, metalness + ambient occlusion
+layout (location = 3) out vec2 gEffects;        // RG16F, velocity
+
+in vec3 viewPos;
+in vec2 TexCoords;
+in vec3 normal;
+in vec4 fragPosition;
+in vec4 fragPrevPosition;
+
+uniform vec3 albedoColor;
+uniform sampler2D texAlbedo;
+uniform sampler2D texNormal;
+uniform sampler2D texRoughness;
+uniform sampler2D texMetalness;
+uniform sampler2D texAO;
+
+vec3 computeTexNormal(vec3 viewNormal, vec3 texNormal);
+vec2 encodeOctahedral(vec3 n);
+
+
+void main()
+{
+    vec2 texNormalXY = texture(texNormal, TexCoords).rg * 2.0f - 1.0f;    // BC5 normal maps only store x and y
+    vec3 texNormal = normalize(vec3(texNormalXY, sqrt(max(1.0f - dot(texNormalXY, texNormalXY), 0.0f))));
+    texNormal.g = -texNormal.g;   // In case the normal map was made with DX3D coordinates system in mind
+
+    // a vertex behind the previous camera has no meaningful previous position, no motion rather than a huge one
+    vec2 fragPosA = (fragPosition.xy / fragPosition.w) * 0.5f + 0.5f;
+    vec2 fragPosB = fragPrevPosition.w > 0.0f ? (fragPrevPosition.xy / fragPrevPosition.w) * 0.5f + 0.5f : fragPosA;
+
+    gAlbedo.rgb = texture(texAlbedo, TexCoords).rgb;
+    gAlbedo.a = texture(texRoughness, TexCoords).r;
+    gNormal = encodeOctahedral(computeTexNormal(normal, texNormal));
+    gMaterial.r = texture(texMetalness, TexCoords).r;
+    gMaterial.g = texture(texAO, TexCoords).r;
+    gEffects = fragPosA - fragPosB;
+}
+
+
+
+vec3 computeTexNormal(vec3 viewNormal, vec3 texNormal)
+{
+    vec3 dPosX  = dFdx(viewPos);
+    vec3 dPosY  = dFdy(viewPos);
+    vec2 dTexX = dFdx(TexCoords);
+    vec2 dTexY = dFdy(TexCoords);
+
+    vec3 normal = normalize(viewNormal);
+    vec3 tangent = normalize(dPosX * dTexY.t - dPosY * dTexX.t);
+    vec3 binormal = -normalize(cross(normal, tangent));
+    mat3 TBN = mat3(tangent, binormal, normal);
+
+    return normalize(TBN * texNormal);
+}
+
+
+// Octahedral normal encoding (Cigolle et al. 2014), the unit sphere folded onto [0, 1]^2,
+// decoded by decodeOctahedral in the passes reading the compact layout
+vec2 encodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    vec2 folded = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+
+    return folded * 0.5f + 0.5f;
+}
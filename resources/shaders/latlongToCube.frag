@@ -1,6 +1,7 @@
-#version 330 core
+#version 400 core
+
+in vec3 cubeCoords;
 out vec4 FragColor;
-in vec3 WorldPos;
 
 uniform sampler2D envMap;
 
@@ -16,9 +17,9 @@ vec2 getSphericalCoord(vec3 normalCoord)
 
 
 void main()
-{		
-    vec2 uv = getSphericalCoord(normalize(WorldPos));
+{
+    vec2 uv = getSphericalCoord(normalize(cubeCoords));
     vec3 color = texture(envMap, uv).rgb;
-    
+
     FragColor = vec4(color, 1.0);
 }
@@ -0,0 +1,14 @@
+#version 400 core
+
+layout (location = 0) in vec3 position;
+
+out vec2 facePosition;
+
+
+// Full screen quad, drawn once for the whole cubemap: the geometry shader routes it to the six faces
+void main()
+{
+    facePosition = position.xy;
+
+    gl_Position = vec4(position, 1.0f);
+}
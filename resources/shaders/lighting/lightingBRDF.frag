@@ -27,14 +27,19 @@ uniform sampler2D gPosition;
 uniform sampler2D gAlbedo;
 uniform sampler2D gNormal;
 uniform sampler2D gEffects;
+uniform sampler2D gDepth;               // compact layout only (gBufferCompact), with gMaterial
+uniform sampler2D gMaterial;
 
 uniform sampler2D sao;
 uniform sampler2D envMap;
-uniform samplerCube envMapIrradiance;
 uniform samplerCube envMapPrefilter;
 uniform sampler2D envMapLUT;
 
 uniform int gBufferView;
+uniform bool gBufferCompact;
+uniform vec4 gBufferProjInfo;           // projection[0][0], [1][1], [2][0], [2][1], depth buffer to view space
+uniform vec2 gBufferDepthInfo;          // projection[2][2], [3][2]
+uniform vec2 renderScale;               // rendered part of the G-buffer, TexCoords are already scaled (lightingBRDF.vert)
 uniform bool pointMode;
 uniform bool directionalMode;
 uniform bool iblMode;
@@ -44,10 +49,14 @@ uniform float materialMetallicity;
 uniform float ambientIntensity;
 uniform vec3 materialF0;
 uniform mat4 view;
+uniform vec3 irradianceSH[9];           // L2 spherical harmonics of the diffuse irradiance, see sphericalHarmonics.h
 
 vec3 colorLinear(vec3 colorVector);
 float saturate(float f);
+vec3 getViewPosition(vec2 texCoords, float depth);
+vec3 decodeOctahedral(vec2 encoded);
 vec2 getSphericalCoord(vec3 normalCoord);
+vec3 computeIrradianceSH(vec3 N);
 float Fd90(float NoL, float roughness);
 float KDisneyTerm(float NoL, float NoV, float roughness);
 vec3 computeFresnelSchlick(float NdotV, vec3 F0);
@@ -58,15 +67,46 @@ float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughne
 
 void main()
 {
-    // Retrieve G-Buffer informations
-    vec3 viewPos = texture(gPosition, TexCoords).rgb;
-    vec3 albedo = colorLinear(texture(gAlbedo, TexCoords).rgb);
-    vec3 normal = texture(gNormal, TexCoords).rgb;
-    float roughness = texture(gAlbedo, TexCoords).a;
-    float metalness = texture(gNormal, TexCoords).a;
-    float ao = texture(gEffects, TexCoords).r;
-    vec2 velocity = texture(gEffects, TexCoords).gb;
-    float depth = texture(gPosition, TexCoords).a;
+    // Retrieve G-Buffer informations, one fetch per target
+    vec4 albedoRoughness = texture(gAlbedo, TexCoords);
+    vec3 albedo = colorLinear(albedoRoughness.rgb);
+    float roughness = albedoRoughness.a;
+
+    vec3 viewPos;
+    vec3 normal;
+    float metalness;
+    float ao;
+    vec2 velocity;
+    float depth;
+    bool background;
+
+    if (gBufferCompact)
+    {
+        float bufferDepth = texture(gDepth, TexCoords).r;
+        vec2 material = texture(gMaterial, TexCoords).rg;
+
+        viewPos = getViewPosition(TexCoords / renderScale, bufferDepth);
+        normal = decodeOctahedral(texture(gNormal, TexCoords).rg);
+        metalness = material.r;
+        ao = material.g;
+        velocity = texture(gEffects, TexCoords).rg;
+        depth = -viewPos.z;
+        background = bufferDepth == 1.0f;
+    }
+    else
+    {
+        vec4 positionDepth = texture(gPosition, TexCoords);
+        vec4 normalMetalness = texture(gNormal, TexCoords);
+        vec3 effects = texture(gEffects, TexCoords).rgb;
+
+        viewPos = positionDepth.xyz;
+        normal = normalMetalness.rgb;
+        metalness = normalMetalness.a;
+        ao = effects.r;
+        velocity = effects.gb;
+        depth = positionDepth.a;
+        background = depth == 1.0f;
+    }
 
     float sao = texture(sao, TexCoords).r;
     vec3 envColor = texture(envMap, getSphericalCoord(normalize(envMapCoords))).rgb;
@@ -75,7 +115,7 @@ void main()
     vec3 diffuse = vec3(0.0f);
     vec3 specular = vec3(0.0f);
 
-    if(depth == 1.0f)
+    if(background)
     {
         color = envColor;
     }
@@ -184,7 +224,7 @@ void main()
             kD *= 1.0f - metalness;
 
             // Diffuse irradiance computation
-            vec3 diffuseIrradiance = texture(envMapIrradiance, N * mat3(view)).rgb;
+            vec3 diffuseIrradiance = computeIrradianceSH(N * mat3(view));
             diffuseIrradiance *= albedo;
 
             // Specular radiance computation
@@ -256,6 +296,28 @@ float saturate(float f)
 }
 
 
+// View space position of a pixel from the depth buffer, the projection is symmetric or not
+vec3 getViewPosition(vec2 texCoords, float depth)
+{
+    float viewZ = -gBufferDepthInfo.y / (depth * 2.0f - 1.0f + gBufferDepthInfo.x);
+    vec2 ndc = texCoords * 2.0f - 1.0f;
+
+    return vec3(-viewZ * (ndc + gBufferProjInfo.zw) / gBufferProjInfo.xy, viewZ);
+}
+
+
+// Inverse of encodeOctahedral (gBufferCompact.frag)
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec2 f = encoded * 2.0f - 1.0f;
+    vec3 n = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+
+    return normalize(n);
+}
+
+
 vec2 getSphericalCoord(vec3 normalCoord)
 {
     float phi = acos(-normalCoord.y);
@@ -265,6 +327,23 @@ vec2 getSphericalCoord(vec3 normalCoord)
 }
 
 
+vec3 computeIrradianceSH(vec3 N)
+{
+    // Constants and cosine convolution are folded into the coefficients on the CPU
+    vec3 irradiance = irradianceSH[0]
+                    + irradianceSH[1] * N.y
+                    + irradianceSH[2] * N.z
+                    + irradianceSH[3] * N.x
+                    + irradianceSH[4] * (N.x * N.y)
+                    + irradianceSH[5] * (N.y * N.z)
+                    + irradianceSH[6] * (3.0f * N.z * N.z - 1.0f)
+                    + irradianceSH[7] * (N.x * N.z)
+                    + irradianceSH[8] * (N.x * N.x - N.y * N.y);
+
+    return max(irradiance, vec3(0.0f));
+}
+
+
 float Fd90(float NoL, float roughness)
 {
     return (2.0f * NoL * roughness) + 0.4f;
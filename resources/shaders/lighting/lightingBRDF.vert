@@ -8,10 +8,11 @@ out vec3 envMapCoords;
 
 uniform mat4 inverseView;
 uniform mat4 inverseProj;
+uniform vec2 renderScale;       // rendered part of the G-buffer, dynamic resolution
 
 void main()
 {
-    TexCoords = texCoords;
+    TexCoords = texCoords * renderScale;
     vec4 unprojCoords = (inverseProj * vec4(position, vec2(1.0f)));
     envMapCoords = (inverseView * unprojCoords).xyz;
 
@@ -11,11 +11,14 @@ float middleGrey = 0.18f;
 uniform sampler2D screenTexture;
 uniform sampler2D sao;
 uniform sampler2D gEffects;
+uniform sampler2D gDepth;
+uniform sampler2D motionBlurNeighborMax;    // longest velocity around each tile, in pixels (motionBlurNeighborMax.frag)
 
 uniform int gBufferView;
 uniform int motionBlurMaxSamples;
 uniform int tonemappingMode;
 uniform bool saoMode;
+uniform bool gBufferCompact;        // velocity in gEffects.rg instead of .gb
 uniform bool fxaaMode;
 uniform bool motionBlurMode;
 uniform float cameraAperture;
@@ -23,8 +26,14 @@ uniform float cameraShutterSpeed;
 uniform float cameraISO;
 uniform float motionBlurScale;
 uniform vec2 screenTextureSize;
+uniform vec2 gBufferDepthInfo;      // projection[2][2], [3][2], depth buffer to view space
+uniform int motionBlurTileSize;
+uniform vec2 renderScale;           // rendered part of the input targets, upscaled to the viewport (dynamic resolution)
 
+vec2 screenCoords;                  // TexCoords (already scaled, postprocess.vert) kept off the texels outside the rendered part
 
+
+vec3 sampleScreen(vec2 texCoords);
 vec3 colorLinear(vec3 colorVector);
 vec3 colorSRGB(vec3 colorVector);
 vec3 ReinhardTM(vec3 color);
@@ -33,11 +42,14 @@ vec3 UnchartedTM(vec3 color);
 float computeSOBExposure(float aperture, float shutterSpeed, float iso);
 vec3 computeFxaa();
 vec3 computeMotionBlur(vec3 colorVector);
+vec2 getMotionBlurVelocity(vec2 texCoords, vec2 renderPixels);
+float getLinearDepth(vec2 texCoords);
 
 
 void main()
 {
     vec3 color;
+    screenCoords = min(TexCoords, renderScale - 0.5f * screenTextureSize);
 
     if(gBufferView == 1)
     {
@@ -45,7 +57,7 @@ void main()
         if(fxaaMode)
             color = computeFxaa();  // Don't know if applying FXAA first is a good idea, especially with effects such as motion blur and DoF...
         else
-            color = texture(screenTexture, TexCoords).rgb;
+            color = sampleScreen(screenCoords);
 
         // Motion Blur computation
         if(motionBlurMode)
@@ -54,7 +66,7 @@ void main()
         // SAO computation
         if(saoMode)
         {
-            float sao = texture(sao, TexCoords).r;
+            float sao = texture(sao, screenCoords).r;
             color *= sao;
         }
 
@@ -85,23 +97,31 @@ void main()
 
     else    // No tonemapping or linear/sRGB conversion if we want to visualize the different buffers
     {
-        color = texture(screenTexture, TexCoords).rgb;
+        color = sampleScreen(screenCoords);
         colorOutput = vec4(color, 1.0f);
     }
 }
 
 
 
+// Bilinear fetch of screenTexture inside its rendered part, the texels past it are left over from larger frames.
+// firstpass.comp filters its shared tile the same way
+vec3 sampleScreen(vec2 texCoords)
+{
+    return texture(screenTexture, min(texCoords, renderScale - 0.5f * screenTextureSize)).rgb;
+}
+
+
 vec3 computeFxaa()
 {
     vec2 screenTextureOffset = screenTextureSize;
     vec3 luma = vec3(0.299f, 0.587f, 0.114f);
 
-    vec3 offsetNW = texture(screenTexture, TexCoords.xy + (vec2(-1.0f, -1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetNE = texture(screenTexture, TexCoords.xy + (vec2(1.0f, -1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetSW = texture(screenTexture, TexCoords.xy + (vec2(-1.0f, 1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetSE = texture(screenTexture, TexCoords.xy + (vec2(1.0f, 1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetM  = texture(screenTexture, TexCoords.xy).xyz;
+    vec3 offsetNW = sampleScreen(screenCoords + (vec2(-1.0f, -1.0f) * screenTextureOffset));
+    vec3 offsetNE = sampleScreen(screenCoords + (vec2(1.0f, -1.0f) * screenTextureOffset));
+    vec3 offsetSW = sampleScreen(screenCoords + (vec2(-1.0f, 1.0f) * screenTextureOffset));
+    vec3 offsetSE = sampleScreen(screenCoords + (vec2(1.0f, 1.0f) * screenTextureOffset));
+    vec3 offsetM  = sampleScreen(screenCoords);
 
     float lumaNW = dot(luma, offsetNW);
     float lumaNE = dot(luma, offsetNE);
@@ -117,11 +137,11 @@ vec3 computeFxaa()
 
     dir = min(vec2(FXAA_SPAN_MAX), max(vec2(-FXAA_SPAN_MAX), dir * dirCorrection)) * screenTextureOffset;
 
-    vec3 resultA = 0.5f * (texture(screenTexture, TexCoords.xy + (dir * vec2(1.0f / 3.0f - 0.5f))).xyz +
-                                    texture(screenTexture, TexCoords.xy + (dir * vec2(2.0f / 3.0f - 0.5f))).xyz);
+    vec3 resultA = 0.5f * (sampleScreen(screenCoords + (dir * vec2(1.0f / 3.0f - 0.5f))) +
+                                    sampleScreen(screenCoords + (dir * vec2(2.0f / 3.0f - 0.5f))));
 
-    vec3 resultB = resultA * 0.5f + 0.25f * (texture(screenTexture, TexCoords.xy + (dir * vec2(0.0f / 3.0f - 0.5f))).xyz +
-                                             texture(screenTexture, TexCoords.xy + (dir * vec2(3.0f / 3.0f - 0.5f))).xyz);
+    vec3 resultB = resultA * 0.5f + 0.25f * (sampleScreen(screenCoords + (dir * vec2(0.0f / 3.0f - 0.5f))) +
+                                             sampleScreen(screenCoords + (dir * vec2(3.0f / 3.0f - 0.5f))));
 
     float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
     float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
@@ -133,23 +153,75 @@ vec3 computeFxaa()
         return vec3(resultB);
 }
 
+// Motion blur reconstruction filter (McGuire et al. 2012, "A Reconstruction Filter for Plausible Motion Blur").
+// The samples are spread along the longest velocity around the tile of the pixel, each one weighted by whether it
+// blurs over the pixel (in front, its own velocity reaches it) or the pixel blurs over it (behind, the velocity
+// of the pixel reaches it). Tiles without motion around them return at once, without a single tap
 vec3 computeMotionBlur(vec3 colorVector)
 {
-    vec2 texelSize = 1.0f / vec2(textureSize(screenTexture, 0));
+    vec2 texturePixels = vec2(textureSize(screenTexture, 0));
+    vec2 renderPixels = texturePixels * renderScale;
+    vec2 pixel = screenCoords * texturePixels;
+
+    vec2 neighborMax = texelFetch(motionBlurNeighborMax, ivec2(pixel) / motionBlurTileSize, 0).rg * 0.5f * motionBlurScale;
+    float neighborLength = length(neighborMax);
+    if (neighborLength < 0.5f)
+        return colorVector;
 
-    vec2 velocity = texture(gEffects, TexCoords).gb;
-    velocity *= motionBlurScale;
+    neighborMax *= min(neighborLength, float(motionBlurTileSize)) / neighborLength;
 
-    float fragSpeed = length(velocity / texelSize);
-    int numSamples = clamp(int(fragSpeed), 1, motionBlurMaxSamples);
+    float depth = getLinearDepth(screenCoords);
+    float velocityLength = max(length(getMotionBlurVelocity(screenCoords, renderPixels)), 0.5f);
 
-    for (int i = 1; i < numSamples; ++i)
+    float totalWeight = 1.0f / velocityLength;
+    vec3 color = colorVector * totalWeight;
+
+    // interleaved gradient noise, offsets the samples per pixel so the steps between them turn into noise
+    float jitter = fract(52.9829189f * fract(dot(gl_FragCoord.xy, vec2(0.06711056f, 0.00583715f)))) - 0.5f;
+    // one tap per pixel of the span, it covers the clamped neighborMax on both sides of the pixel
+    int numSamples = clamp(int(2.0f * min(neighborLength, float(motionBlurTileSize))), 2, max(motionBlurMaxSamples, 2));
+
+    for (int i = 0; i < numSamples; ++i)
     {
-        vec2 blurOffset = velocity * (float(i) / float(numSamples - 1) - 0.5f);
-        colorVector += texture(screenTexture, TexCoords + blurOffset).rgb;
+        float t = mix(-1.0f, 1.0f, (float(i) + jitter + 1.0f) / float(numSamples + 1));
+        float distance = abs(t) * length(neighborMax);
+        vec2 sampleCoords = clamp((pixel + neighborMax * t) / texturePixels, vec2(0.0f), renderScale - 0.5f * screenTextureSize);
+
+        float sampleDepth = getLinearDepth(sampleCoords);
+        float sampleLength = max(length(getMotionBlurVelocity(sampleCoords, renderPixels)), 0.5f);
+
+        // soft depth comparison, relative to the depth of the pixel
+        float foreground = clamp(1.0f - (sampleDepth - depth) / (0.05f * depth), 0.0f, 1.0f);
+        float background = clamp(1.0f - (depth - sampleDepth) / (0.05f * depth), 0.0f, 1.0f);
+
+        float weight = foreground * clamp(1.0f - distance / sampleLength, 0.0f, 1.0f)
+                     + background * clamp(1.0f - distance / velocityLength, 0.0f, 1.0f)
+                     + 2.0f * (1.0f - smoothstep(0.95f * sampleLength, 1.05f * sampleLength, distance))
+                            * (1.0f - smoothstep(0.95f * velocityLength, 1.05f * velocityLength, distance));
+
+        color += sampleScreen(sampleCoords) * weight;
+        totalWeight += weight;
     }
 
-    return colorVector /= float(numSamples);
+    return color / totalWeight;
+}
+
+
+// Half the motion of the last frame in pixels, the blur spans it on both sides of the pixel, at most a tile
+vec2 getMotionBlurVelocity(vec2 texCoords, vec2 renderPixels)
+{
+    vec3 effects = texture(gEffects, texCoords).rgb;
+    vec2 velocity = (gBufferCompact ? effects.rg : effects.gb) * renderPixels * 0.5f * motionBlurScale;
+    float velocityLength = length(velocity);
+
+    return velocityLength > float(motionBlurTileSize) ? velocity * float(motionBlurTileSize) / velocityLength : velocity;
+}
+
+
+// Positive view space depth, from the depth buffer
+float getLinearDepth(vec2 texCoords)
+{
+    return gBufferDepthInfo.y / (texture(gDepth, texCoords).r * 2.0f - 1.0f + gBufferDepthInfo.x);
 }
 
 
@@ -0,0 +1,34 @@
+#version 400 core
+
+out vec2 neighborMaxOutput;
+
+uniform sampler2D tileMax;          // motionBlurTileMax.frag
+uniform ivec2 tileCount;            // rendered part of the tile buffers
+
+
+// Neighbour-max pass of the motion blur reconstruction: the longest tile velocity of the 3x3 tiles around each
+// tile, so the pixels a fast object blurs over, outside its own tiles, still sample along its motion
+void main()
+{
+    ivec2 tile = ivec2(gl_FragCoord.xy);
+
+    vec2 maxVelocity = vec2(0.0f);
+    float maxLengthSquared = 0.0f;
+
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec2 velocity = texelFetch(tileMax, clamp(tile + ivec2(x, y), ivec2(0), tileCount - 1), 0).rg;
+            float lengthSquared = dot(velocity, velocity);
+
+            if (lengthSquared > maxLengthSquared)
+            {
+                maxVelocity = velocity;
+                maxLengthSquared = lengthSquared;
+            }
+        }
+    }
+
+    neighborMaxOutput = maxVelocity;
+}
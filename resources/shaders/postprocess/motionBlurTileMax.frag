@@ -0,0 +1,40 @@
+#version 400 core
+
+out vec2 tileMaxOutput;
+
+uniform sampler2D gEffects;         // screen space velocity in .gb (current - previous position), .rg when compact
+
+uniform bool gBufferCompact;
+uniform int motionBlurTileSize;     // pixels per side of a tile
+uniform ivec2 renderSize;           // rendered part of the G-buffer, dynamic resolution
+
+
+// Tile-max pass of the motion blur reconstruction (McGuire et al. 2012, "A Reconstruction Filter for Plausible
+// Motion Blur"): the longest velocity of each tile of pixels, in pixels so the lengths compare the same way on
+// both axes. Read by motionBlurNeighborMax.frag
+void main()
+{
+    ivec2 tileOrigin = ivec2(gl_FragCoord.xy) * motionBlurTileSize;
+    ivec2 tileEnd = min(tileOrigin + motionBlurTileSize, renderSize);
+
+    vec2 maxVelocity = vec2(0.0f);
+    float maxLengthSquared = 0.0f;
+
+    for (int y = tileOrigin.y; y < tileEnd.y; ++y)
+    {
+        for (int x = tileOrigin.x; x < tileEnd.x; ++x)
+        {
+            vec3 effects = texelFetch(gEffects, ivec2(x, y), 0).rgb;
+            vec2 velocity = (gBufferCompact ? effects.rg : effects.gb) * vec2(renderSize);
+            float lengthSquared = dot(velocity, velocity);
+
+            if (lengthSquared > maxLengthSquared)
+            {
+                maxVelocity = velocity;
+                maxLengthSquared = lengthSquared;
+            }
+        }
+    }
+
+    tileMaxOutput = maxVelocity;
+}
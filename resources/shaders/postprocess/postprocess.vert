@@ -5,10 +5,12 @@ layout (location = 1) in vec2 texCoords;
 
 out vec2 TexCoords;
 
+uniform vec2 renderScale;       // rendered part of the targets, dynamic resolution
+
 
 void main()
 {
-    TexCoords = texCoords;
+    TexCoords = texCoords * renderScale;
 
     gl_Position = vec4(position.x, position.y, 0.0f, 1.0f);
 }
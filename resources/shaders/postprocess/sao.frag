@@ -9,29 +9,48 @@ float saoEpsilon = 0.01f;
 
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
+uniform sampler2D saoDepth;     // camera space z with its mip pyramid (saoDepthMip.frag)
 
 uniform int viewportWidth;
 uniform int viewportHeight;
 uniform int saoSamples;
 uniform int saoTurns;
+uniform int saoResolution;      // 1 full, 2 half, 4 quarter, gPosition / gNormal are then the downsampled buffers
 uniform float saoRadius;
 uniform float saoBias;
 uniform float saoScale;
 uniform float saoContrast;
+uniform float saoPhiOffset;     // rotation of the sample spiral, changes every frame when accumulated over time
+uniform vec4 saoProjInfo;       // pixel of the SAO buffer to camera space xy at z = 1, from the projection matrix
+uniform ivec2 saoRenderSize;    // rendered part of the SAO buffers (dynamic resolution), the pyramid levels halve it
+
+
+// Camera space position of a sample, its z from the pyramid level matching the sampling distance: the samples of
+// a wide radius are sparse, reading a coarser level keeps them in the texture cache
+vec3 getOffsetPosition(ivec2 pixel, vec2 unitOffset, float distance)
+{
+    int saoMaxMipLevel = textureQueryLevels(saoDepth) - 1;
+    int saoM = clamp(findMSB(int(distance)) - saoQ, 0, saoMaxMipLevel);
+
+    ivec2 samplePixel = ivec2(distance * unitOffset) + pixel;
+    ivec2 mipPixel = clamp(samplePixel >> saoM, ivec2(0), max(saoRenderSize >> saoM, ivec2(1)) - 1);
+    float z = texelFetch(saoDepth, mipPixel, saoM).r;
+
+    return vec3((vec2(samplePixel) + 0.5f) * saoProjInfo.xy + saoProjInfo.zw, 1.0f) * z;
+}
 
 
 void main(void){
-    vec3 fragPos = texture(gPosition, TexCoords).xyz;
-    vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
+    vec3 fragPos = texelFetch(gPosition, ivec2(gl_FragCoord.xy), 0).xyz;
+    vec3 normal = normalize(texelFetch(gNormal, ivec2(gl_FragCoord.xy), 0).rgb);
 
     float saoOcclusion = 0.0f;
 
     // AlchemyAO XOR hash to randomize our sample offset rotation
     ivec2 saoOffset = ivec2(gl_FragCoord.xy);
-    float saoPhi = (30 * saoOffset.x ^ saoOffset.y + 10 * saoOffset.x * saoOffset.y);
+    float saoPhi = (30 * saoOffset.x ^ saoOffset.y + 10 * saoOffset.x * saoOffset.y) + saoPhiOffset;
 
-    const float saoScreenRadius = saoRadius * (1 - fragPos.z);   // radius should decrease as you go away from object
-    int saoMaxMipLevel = textureQueryLevels(gPosition) - 1;
+    const float saoScreenRadius = saoRadius * (1 - fragPos.z) / saoResolution;   // radius should decrease as you go away from object, in pixels of the buffer
 
     for (int i = 0; i < saoSamples; ++i)
     {
@@ -40,8 +59,7 @@ void main(void){
         float saoTetha = 2.0f * PI * saoAlpha * saoTurns + saoPhi;
         vec2 saoU = vec2(cos(saoTetha), sin(saoTetha));
 
-        int saoM = clamp(findMSB(int(saoH)) - 4, 0, saoMaxMipLevel);
-        vec3 saoSampleOffset = texelFetch(gPosition, ivec2(saoH * saoU + saoOffset) >> saoM, saoM).xyz;
+        vec3 saoSampleOffset = getOffsetPosition(saoOffset, saoU, saoH);
         vec3 saoV = saoSampleOffset - fragPos;
 
         // AlchemyAO obscurance estimator
@@ -5,9 +5,11 @@ layout (location = 1) in vec2 texCoords;
 
 out vec2 TexCoords;
 
+uniform vec2 renderScale;       // rendered part of the targets, dynamic resolution
+
 
 void main()
 {
     gl_Position = vec4(position, 1.0f);
-    TexCoords = texCoords;
+    TexCoords = texCoords * renderScale;
 }
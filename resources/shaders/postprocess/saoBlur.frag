@@ -1,25 +1,60 @@
 #version 400 core
 
-in vec2 TexCoords;
 out float saoBlurOutput;
 
 uniform sampler2D saoInput;
-uniform int saoBlurSize;
+uniform sampler2D saoDepth;         // camera space z (level 0 of the pyramid)
+uniform sampler2D saoNormal;
 
+uniform ivec2 saoBlurDirection;     // (1, 0) then (0, 1), the two passes of the separable blur
+uniform int saoBlurSize;            // radius in texels
+uniform ivec2 saoRenderSize;        // rendered part of the SAO buffers, dynamic resolution
 
+const float saoBlurDepthSharpness = 8.0f;       // falloff with the depth difference relative to the center depth
+const float saoBlurNormalPower = 8.0f;          // falloff with the angle between the normals
+
+
+// One axis of a separable bilateral blur: gaussian weights, scaled down for the texels lying on another surface
+// (depth and normal) so the occlusion does not bleed across silhouettes. Same math as saoBlur.comp.
+// The G-buffer normals are unit length, the zero normal of the background gives its texels no weight
 void main()
 {
-   vec2 texelSize = 1.0 / vec2(textureSize(saoInput, 0));
-   float result = 0.0;
-
-   for (int x = 0; x < saoBlurSize; ++x)
-   {
-      for (int y = 0; y < saoBlurSize; ++y)
-      {
-         vec2 offset = (vec2(-2.0) + vec2(float(x), float(y))) * texelSize;
-         result += texture(saoInput, TexCoords + offset).r;
-      }
-   }
-
-   saoBlurOutput = result / float(saoBlurSize * saoBlurSize);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 size = saoRenderSize;
+
+    float centerOcclusion = texelFetch(saoInput, texel, 0).r;
+    float centerDepth = texelFetch(saoDepth, texel, 0).r;
+
+    // no geometry, nothing to blur across
+    if (centerDepth >= 0.0f || saoBlurSize == 0)
+    {
+        saoBlurOutput = centerOcclusion;
+        return;
+    }
+
+    vec3 centerNormal = texelFetch(saoNormal, texel, 0).rgb;
+    float sigma = max(float(saoBlurSize) * 0.5f, 0.5f);
+
+    float occlusion = centerOcclusion;
+    float totalWeight = 1.0f;
+
+    for (int i = -saoBlurSize; i <= saoBlurSize; ++i)
+    {
+        if (i == 0)
+            continue;
+
+        ivec2 sampleTexel = clamp(texel + saoBlurDirection * i, ivec2(0), size - 1);
+        float sampleDepth = texelFetch(saoDepth, sampleTexel, 0).r;
+        vec3 sampleNormal = texelFetch(saoNormal, sampleTexel, 0).rgb;
+
+        float depthDifference = abs(sampleDepth - centerDepth) / -centerDepth;
+        float weight = exp(-float(i * i) / (2.0f * sigma * sigma))
+                     * max(0.0f, 1.0f - saoBlurDepthSharpness * depthDifference)
+                     * pow(max(dot(centerNormal, sampleNormal), 0.0f), saoBlurNormalPower);
+
+        occlusion += texelFetch(saoInput, sampleTexel, 0).r * weight;
+        totalWeight += weight;
+    }
+
+    saoBlurOutput = occlusion / totalWeight;
 }
@@ -0,0 +1,26 @@
+#version 400 core
+
+out float saoDepthOutput;
+
+uniform sampler2D depthInput;       // positions (first level) or the previous level of the pyramid
+uniform bool fromPosition;
+uniform ivec2 previousSize;         // rendered part of the previous level
+
+
+// Camera space Z pyramid of SAO (McGuire et al. 2012, "Scalable Ambient Obscurance"). The first level copies
+// the z of the positions, each next level keeps one texel of every 2x2 block of the previous one on a rotated
+// grid instead of averaging, so every texel stays an actual depth of the scene
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    if (fromPosition)
+    {
+        saoDepthOutput = texelFetch(depthInput, texel, 0).z;
+        return;
+    }
+
+    ivec2 previousTexel = texel * 2 + ivec2(texel.y & 1, texel.x & 1);
+
+    saoDepthOutput = texelFetch(depthInput, min(previousTexel, previousSize - 1), 0).r;
+}
@@ -0,0 +1,88 @@
+#version 400 core
+
+layout (location = 0) out vec4 saoPositionOutput;
+layout (location = 1) out vec3 saoNormalOutput;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform int saoResolution;      // size of the block of G-buffer pixels behind each output texel
+uniform bool gBufferCompact;    // positions from gDepth, octahedral normals, converted to the layout SAO reads
+uniform vec4 gBufferProjInfo;
+uniform vec2 gBufferDepthInfo;
+uniform ivec2 renderSize;       // rendered part of the G-buffer, dynamic resolution
+
+
+// Reduced resolution position and normal for SAO. Averaging would invent surfaces floating between a
+// foreground and a background, so each block keeps one of its actual samples: the one nearest to the camera.
+// Pixels without geometry have a zero view space position and are only picked when the block is empty.
+// The compact G-buffer goes through here at full resolution as well (saoResolution 1)
+vec3 getViewPosition(vec2 texCoords, float depth);
+vec3 decodeOctahedral(vec2 encoded);
+
+
+vec4 getPosition(ivec2 texel)
+{
+    if (!gBufferCompact)
+        return texelFetch(gPosition, texel, 0);
+
+    float depth = texelFetch(gDepth, texel, 0).r;
+    if (depth == 1.0f)
+        return vec4(0.0f);
+
+    vec3 position = getViewPosition((vec2(texel) + 0.5f) / vec2(renderSize), depth);
+    return vec4(position, -position.z);
+}
+
+
+void main()
+{
+    ivec2 blockOrigin = ivec2(gl_FragCoord.xy) * saoResolution;
+
+    ivec2 nearestTexel = min(blockOrigin, renderSize - 1);
+    vec4 nearestPosition = getPosition(nearestTexel);
+
+    for (int y = 0; y < saoResolution; ++y)
+    {
+        for (int x = 0; x < saoResolution; ++x)
+        {
+            ivec2 texel = min(blockOrigin + ivec2(x, y), renderSize - 1);
+            vec4 position = getPosition(texel);
+
+            if (position.z < 0.0f && (nearestPosition.z >= 0.0f || position.z > nearestPosition.z))
+            {
+                nearestPosition = position;
+                nearestTexel = texel;
+            }
+        }
+    }
+
+    saoPositionOutput = nearestPosition;
+    if (!gBufferCompact)
+        saoNormalOutput = texelFetch(gNormal, nearestTexel, 0).rgb;
+    else
+        saoNormalOutput = nearestPosition.z < 0.0f ? decodeOctahedral(texelFetch(gNormal, nearestTexel, 0).rg) : vec3(0.0f);
+}
+
+
+// View space position of a pixel from the depth buffer, as in lightingBRDF.frag
+vec3 getViewPosition(vec2 texCoords, float depth)
+{
+    float viewZ = -gBufferDepthInfo.y / (depth * 2.0f - 1.0f + gBufferDepthInfo.x);
+    vec2 ndc = texCoords * 2.0f - 1.0f;
+
+    return vec3(-viewZ * (ndc + gBufferProjInfo.zw) / gBufferProjInfo.xy, viewZ);
+}
+
+
+// Inverse of encodeOctahedral (gBufferCompact.frag)
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec2 f = encoded * 2.0f - 1.0f;
+    vec3 n = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+
+    return normalize(n);
+}
@@ -0,0 +1,51 @@
+#version 400 core
+
+in vec2 TexCoords;
+out vec2 saoHistoryOutput;          // occlusion, camera space z it was computed at
+
+uniform sampler2D saoInput;         // this frame's occlusion, few samples
+uniform sampler2D saoDepth;         // camera space z (level 0 of the pyramid)
+uniform sampler2D saoHistory;       // previous saoHistoryOutput
+uniform sampler2D gEffects;         // screen space velocity in .gb (current - previous position), .rg when compact
+
+uniform bool gBufferCompact;
+uniform bool saoHistoryValid;       // false on the first frame and after a resize
+uniform float saoTemporalBlend;     // weight of the fresh samples, 1 / number of frames accumulated
+uniform vec2 renderScale;           // rendered part of the targets this frame, TexCoords are already scaled (sao.vert)
+uniform ivec2 saoHistorySize;       // rendered part of the history, the previous frame could use another scale
+
+const float saoTemporalDepthThreshold = 0.05f;      // relative depth difference past which the history is discarded
+
+
+// Temporal accumulation of SAO: this frame's samples (rotated every frame by sao.frag) are blended into the
+// occlusion of the previous frame, reprojected with the velocity of the G-buffer. History that landed on
+// another surface (disocclusion, off screen) is dropped and the fresh value used as is
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float occlusion = texelFetch(saoInput, texel, 0).r;
+    float depth = texelFetch(saoDepth, texel, 0).r;
+
+    if (!saoHistoryValid || depth >= 0.0f)
+    {
+        saoHistoryOutput = vec2(occlusion, depth);
+        return;
+    }
+
+    // a non finite velocity passes the bounds test below (NaN compares false), it is rejected first
+    vec3 effects = texture(gEffects, TexCoords).rgb;
+    vec2 velocity = gBufferCompact ? effects.rg : effects.gb;
+    vec2 previousCoords = TexCoords / renderScale - velocity;
+    if (any(isnan(velocity)) || any(isinf(velocity))
+        || any(lessThan(previousCoords, vec2(0.0f))) || any(greaterThanEqual(previousCoords, vec2(1.0f))))
+    {
+        saoHistoryOutput = vec2(occlusion, depth);
+        return;
+    }
+
+    // nearest texel, filtering would blend the depths of both sides of an edge
+    vec2 history = texelFetch(saoHistory, ivec2(previousCoords * vec2(saoHistorySize)), 0).rg;
+    float blend = abs(history.g - depth) > saoTemporalDepthThreshold * -depth ? 1.0f : saoTemporalBlend;
+
+    saoHistoryOutput = vec2(mix(history.r, occlusion, blend), depth);
+}
@@ -0,0 +1,87 @@
+#version 400 core
+
+in vec2 TexCoords;
+out float saoUpsampleOutput;
+
+uniform sampler2D saoInput;         // blurred occlusion at the reduced resolution
+uniform sampler2D saoPosition;      // positions it was computed from (saoDownsample.frag)
+uniform sampler2D gPosition;
+uniform sampler2D gDepth;
+
+uniform bool gBufferCompact;        // full resolution depth from gDepth instead of gPosition
+uniform vec4 gBufferProjInfo;
+uniform vec2 gBufferDepthInfo;
+uniform vec2 renderScale;           // rendered part of the G-buffer, TexCoords are already scaled (sao.vert)
+uniform ivec2 saoRenderSize;        // rendered part of the reduced buffers
+
+const float saoDepthSharpness = 16.0f;  // falloff of the weight with the relative depth difference
+
+
+// Joint bilateral upsample: the four reduced texels around the pixel are blended with their bilinear weights,
+// scaled down when their depth differs from the depth of the pixel, so the occlusion does not bleed across edges
+vec3 getViewPosition(vec2 texCoords, float depth);
+
+
+void main()
+{
+    float depth;
+    if (gBufferCompact)
+    {
+        float bufferDepth = texelFetch(gDepth, ivec2(gl_FragCoord.xy), 0).r;
+        depth = bufferDepth == 1.0f ? 0.0f : getViewPosition(TexCoords / renderScale, bufferDepth).z;
+    }
+    else
+        depth = texelFetch(gPosition, ivec2(gl_FragCoord.xy), 0).z;
+
+    // no geometry, nothing to occlude
+    if (depth >= 0.0f)
+    {
+        saoUpsampleOutput = 1.0f;
+        return;
+    }
+
+    vec2 saoSize = vec2(textureSize(saoInput, 0));
+    vec2 samplePosition = TexCoords * saoSize - 0.5f;
+    ivec2 baseTexel = ivec2(floor(samplePosition));
+    vec2 bilinear = samplePosition - vec2(baseTexel);
+
+    float occlusion = 0.0f;
+    float totalWeight = 0.0f;
+    float nearestOcclusion = 1.0f;
+    float nearestDifference = 1e30f;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(baseTexel + offset, ivec2(0), saoRenderSize - 1);
+
+        float sampleDepth = texelFetch(saoPosition, texel, 0).z;
+        float sampleOcclusion = texelFetch(saoInput, texel, 0).r;
+        float difference = abs(sampleDepth - depth) / -depth;
+
+        vec2 axisWeights = mix(1.0f - bilinear, bilinear, vec2(offset));
+        float weight = axisWeights.x * axisWeights.y / (1.0f + saoDepthSharpness * difference * saoDepthSharpness * difference);
+
+        occlusion += sampleOcclusion * weight;
+        totalWeight += weight;
+
+        if (difference < nearestDifference)
+        {
+            nearestDifference = difference;
+            nearestOcclusion = sampleOcclusion;
+        }
+    }
+
+    // every neighbour lies on another surface (thin features), take the closest in depth
+    saoUpsampleOutput = totalWeight > 1e-3f ? occlusion / totalWeight : nearestOcclusion;
+}
+
+
+// View space position of a pixel from the depth buffer, as in lightingBRDF.frag
+vec3 getViewPosition(vec2 texCoords, float depth)
+{
+    float viewZ = -gBufferDepthInfo.y / (depth * 2.0f - 1.0f + gBufferDepthInfo.x);
+    vec2 ndc = texCoords * 2.0f - 1.0f;
+
+    return vec3(-viewZ * (ndc + gBufferProjInfo.zw) / gBufferProjInfo.xy, viewZ);
+}
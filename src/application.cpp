@@ -5,6 +5,11 @@
 #include <string>
 #include <memory>
 #include <filesystem>
+#include <deque>
+#include <future>
+#include <limits>
+#include <algorithm>
+#include <chrono>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -22,9 +27,16 @@
 #include <components/shader_m.h>
 #include <components/camera.h>
 #include <components/model.h>
+#include <components/modelloader.h>
 #include <components/entity.h>
 
 #include "texture.h"
+#include "textureCache.h"
+#include "textureStreamer.h"
+#include "ktx.h"
+#include "iblCache.h"
+#include "renderTargetPool.h"
+#include "iblBaker.h"
 #include "shape.h"
 
 
@@ -61,8 +73,19 @@ bool DecomposeTransform(const glm::mat4& transform, glm::vec3& translation, glm:
 void gBufferSetup();
 void saoSetup();
 void postprocessSetup();
+void motionBlurSetup();
 void screenSetup();
-void iblSetup();
+void iblLoad(const char* path, std::string name);
+void iblUpdate(float budgetMs);
+void iblFinish();
+void iblApply(bool save);
+void brdfLUTSetup();
+bool brdfLUTValidate();
+void formatDiffStart();
+void formatDiffUpdate();
+void dynamicResolutionUpdate();
+void qualityApply(GLfloat saoLevel, GLfloat postprocessLevel);
+void qualityGovernorUpdate();
 
 // settings
 unsigned int SCR_WIDTH = 1400;
@@ -78,20 +101,32 @@ bool mouseDragEnabled = false;
 
 
 GLuint screenQuadVAO, screenQuadVBO;
-GLuint gBuffer, zBuffer, gPosition, gNormal, gAlbedo, gEffects;
+GLuint gBuffer, gDepth, gPosition, gNormal, gAlbedo, gEffects;
+GLuint gMaterial;           // compact layout only, gPosition is legacy layout only
 GLuint saoFBO, saoBlurFBO, saoBuffer, saoBlurBuffer;
+GLuint saoDownsampleFBO, saoUpsampleFBO, saoPosition, saoNormal, saoUpsampleBuffer;
+GLuint saoDepthFBO, saoDepthBuffer;
+GLuint saoBlurTempFBO, saoBlurTempBuffer;      // horizontal pass of the blur
+GLuint saoHistoryFBO[2], saoHistoryBuffer[2];   // accumulated occlusion and its depth, written and read in turns
+GLuint saoResult;           // full resolution occlusion read by the lighting and post-processing, saoBlurBuffer or saoUpsampleBuffer
 GLuint postprocessFBO, postprocessBuffer;
-GLuint screenFBO, screenBuffer;
-GLuint envToCubeFBO, irradianceFBO, prefilterFBO, brdfLUTFBO, envToCubeRBO, irradianceRBO, prefilterRBO, brdfLUTRBO;
+GLuint motionBlurTileFBO, motionBlurTileMax, motionBlurNeighborFBO, motionBlurNeighborMax;     // longest velocities per tile
+GLuint screenFBO, screenBuffer, screenZBuffer;
+GLuint envToCubeFBO, prefilterFBO, brdfLUTFBO;
+GLuint prefilterSampleUBO;
 
 GLint gBufferView = 1;
 GLint tonemappingMode = 1;
 GLint lightDebugMode = 3;
 GLint attenuationMode = 2;
-GLint saoSamples = 32;
+GLint saoSamples = 8;           // per frame, the temporal accumulation spreads them over frames
 GLint saoTurns = 10;
-GLint saoBlurSize = 2;
+GLint saoBlurSize = 4;          // radius of the separable bilateral blur, in texels of the SAO buffer
+GLint saoResolution = 2;        // occlusion computed per 1x1 (full), 2x2 (half) or 4x4 (quarter) block of pixels
+GLuint saoDepthLevels = 1;      // levels of the camera space z pyramid, at most saoMaxDepthLevels (fewer for tiny viewports)
+const GLuint saoMaxDepthLevels = 5;
 GLint motionBlurMaxSamples = 32;
+const GLuint motionBlurTileSize = 20;     // pixels per side of a tile, also how far the blur reaches on each side of a pixel
 
 GLfloat deltaTime = 0.0f;
 GLfloat lastFrame = 0.0f;
@@ -104,10 +139,15 @@ GLfloat deltaGUITime = 0.0f;
 GLfloat materialRoughness = 0.01f;
 GLfloat materialMetallicity = 0.02f;
 GLfloat ambientIntensity = 1.0f;
+GLfloat brdfLUTMaxError = -1.0f;              // last brdfLUTValidate() result, negative until run
+GLfloat brdfLUTMeanError = 0.0f;
+GLfloat formatDiffPSNR = -1.0f;               // last formatDiffUpdate() result, negative until run
+GLfloat formatDiffMaxError = 0.0f;
 GLfloat saoRadius = 6.5f;
 GLfloat saoBias = 0.006f;
 GLfloat saoScale = 0.7f;
 GLfloat saoContrast = 0.9f;
+GLfloat saoTemporalBlend = 0.125f;      // weight of the fresh samples, 8 frames of 8 samples converge to about 64
 GLfloat lightPointRadius1 = 3.0f;
 GLfloat lightPointRadius2 = 3.0f;
 GLfloat lightPointRadius3 = 3.0f;
@@ -115,12 +155,42 @@ GLfloat cameraAperture = 16.0f;
 GLfloat cameraShutterSpeed = 0.5f;
 GLfloat cameraISO = 1000.0f;
 GLfloat modelRotationSpeed = 0.0f;
+GLfloat modelUploadBudget = 4.0f;       // ms per frame spent uploading streamed models
+GLfloat textureStreamBudget = 2.0f;     // ms per frame spent copying mip levels into the staging buffers
+GLfloat iblBakeBudget = 1.0f;           // ms of GPU time per frame spent baking a new environment
+GLfloat dynamicResolutionTarget = 15.0f;    // ms of GPU time per frame, 60 Hz with some headroom for the CPU and the swap
+GLfloat renderScale = 1.0f;             // internal resolution / viewport size, set by dynamicResolutionUpdate()
+GLfloat renderScaleMin = 0.5f;
+
+// Storage of the HDR environment per use, GL_RGB32F (12 bytes per texel), GL_RGBA16F (8) or GL_RGB9_E5 (4)
+// The reflections sample the prefiltered cubemap, rendered as GL_RGBA16F and cached as RGB half floats
+GLenum envMapBackgroundFormat = GL_RGB9_E5;     // only displayed, its IBL comes from the cache
+GLenum envMapBakeSourceFormat = GL_RGBA16F;     // sampled by the IBL bake, per channel exponents keep dim channels next to bright ones
+
+// Storage of the intermediate color targets, GL_RGBA32F (16 bytes per pixel), GL_RGBA16F (8) or GL_R11F_G11F_B10F (4)
+GLenum postprocessFormat = GL_R11F_G11F_B10F;  // lighting pass result, HDR but never negative, read by the post-processing
+GLenum screenFormat = GL_RGBA16F;               // post-processing result shown in the viewport, the forward pass blends into it
+GLint formatDiffStep = 0;                       // frame of the reference / configured formats comparison, 0 when idle
+bool formatCheckMode = false;                   // --check-formats: compares once the scene is loaded, then exits with the result
+GLenum formatDiffSaved[2];                      // configured formats while the reference frame renders
+std::vector<float> formatDiffReference;
 
 bool cameraMode;
 bool pointMode = true;
 bool directionalMode = true;
 bool iblMode = true;
+bool computeSupported = false;          // GL 4.3 context, the passes with a compute variant can use it
+bool iblComputeMode = false;
+bool saoBlurComputeMode = false;
+bool postprocessComputeMode = false;    // firstpass.comp, shared memory tiles, instead of firstpass.frag
+bool gBufferCompactMode = true;         // gBufferCompact.frag layout, the legacy one (gBuffer.frag) is kept to compare
 bool saoMode = true;
+bool saoTemporalMode = true;
+bool saoHistoryValid = false;           // the history buffer holds the previous frame, at the current size
+GLuint saoHistoryIndex = 0;             // history buffer written this frame
+GLuint saoFrameIndex = 0;
+glm::ivec2 saoHistorySize = glm::ivec2(1);  // rendered part of the history buffer written last frame
+bool dynamicResolutionMode = true;
 bool fxaaMode = true;
 bool motionBlurMode = true;
 bool screenMode = false;
@@ -138,30 +208,30 @@ glm::vec3 modelPosition = glm::vec3(0.0f);
 glm::vec3 modelRotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
 glm::vec3 modelScale = glm::vec3(0.1f);
 
-glm::mat4 projViewModel;
-glm::mat4 prevProjViewModel = projViewModel;
-glm::mat4 envMapProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-glm::mat4 envMapView[] =
-{
-    glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-    glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-    glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-    glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-    glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-    glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-};
+glm::mat4 prevViewProjection = glm::mat4(1.0f);    // camera of the previous frame, for the G-buffer velocity
+bool prevViewProjectionValid = false;
 
 
 Shader gBufferShader;
+Shader gBufferCompactShader;
 Shader latlongToCubeShader;
 Shader simpleShader;
 Shader lightingBRDFShader;
-Shader irradianceIBLShader;
 Shader prefilterIBLShader;
+Shader latlongToCubeComputeShader;      // compute variants of the IBL bake, only compiled on a GL 4.3 context
+Shader prefilterIBLComputeShader;
 Shader integrateIBLShader;
 Shader firstpassPPShader;
 Shader saoShader;
 Shader saoBlurShader;
+Shader saoDownsampleShader;
+Shader saoUpsampleShader;
+Shader saoDepthMipShader;
+Shader saoBlurComputeShader;
+Shader firstpassPPComputeShader;
+Shader saoTemporalShader;
+Shader motionBlurTileMaxShader;
+Shader motionBlurNeighborMaxShader;
 
 Texture objectAlbedo;
 Texture objectNormal;
@@ -170,15 +240,92 @@ Texture objectMetalness;
 Texture objectAO;
 Texture envMapHDR;
 Texture envMapCube;
-Texture envMapIrradiance;
 Texture envMapPrefilter;
 Texture envMapLUT;
+Texture envMapHDRNext;          // environment being baked, swapped with envMapHDR / envMapPrefilter once complete
+Texture envMapPrefilterNext;
+IBLBakeSettings iblBakeSettings;
+std::vector<std::vector<PrefilterSample>> prefilterSampleTables;     // per prefilter mip, see buildPrefilterSamples
+
+// Environment switches are baked over several frames (iblUpdate), a strip of rows of all six faces at a time
+enum IBLBakePass { IBL_BAKE_UPLOAD, IBL_BAKE_CUBE, IBL_BAKE_CUBE_MIPMAP, IBL_BAKE_PREFILTER };
+
+struct IBLBakeJob
+{
+    IBLBakePass pass;
+    GLuint mip;
+    GLuint firstRow;
+    GLuint rowCount;
+    double work;                // texels * samples, scaled by the measured GPU cost to fit the budget (bytes for the uploads)
+};
+
+const double iblBakeTileWork = 256.0 * 1024.0;     // texel samples per job
+const double iblBakeUploadBytes = 4.0 * 1024.0 * 1024.0;    // bytes of the environment sent per upload job
+const GLuint iblBakeQueryCount = 4;                 // batches timed in flight
+
+// Decoded on a worker thread (iblLoad): the .hdr packed to the format of its texture, its irradiance SH and whether
+// the cache already holds its prefiltered cubemap
+struct IBLDecodedEnvironment
+{
+    std::string name;
+    HDRPackedImageData image;   // no pixels when the file failed to load
+    IrradianceSH irradiance;
+    std::string prefilterPath;
+    bool cached = false;
+};
+
+struct IBLBakeState
+{
+    std::future<IBLDecodedEnvironment> decoding;    // environment switched to, its bake starts once it is decoded
+    IBLDecodedEnvironment environment;          // rows still to upload, freed once the last one is sent
+    bool cached = false;                        // the prefilter comes from the cache once the upload jobs are done
+    std::deque<IBLBakeJob> jobs;
+    size_t jobCount = 0;                        // jobs queued for the current environment, for the progress bar
+    GLuint uploadedMip = ~0u;                   // prefilter level whose samples are in prefilterSampleUBO
+    GLsync fence = 0;                           // set after the last job, the environment goes live once it signals
+    std::string prefilterPath;
+    double nsPerWork = 0.1;                     // GPU time per texel sample, refined by the timer queries
+    double nsPerUploadByte = 0.25;              // CPU time of the upload jobs, refined as they run
+    GLuint queries[iblBakeQueryCount] = {};
+    double queryWork[iblBakeQueryCount] = {};   // work timed by each query, 0 when the query is free
+} iblBake;
+
+void iblStart(IBLDecodedEnvironment& environment);
+void iblQueueBake();
+bool iblApplyCached();
+
+// Sample counts of SAO and motion blur, fixed by a preset or moved between the low and high ones by the governor
+// (qualityGovernorUpdate) to keep the SAO and post-processing passes inside their budgets. Manual leaves them to the
+// SAO panel, editing one of them there switches to it
+enum QualityPreset { QUALITY_LOW, QUALITY_MEDIUM, QUALITY_HIGH, QUALITY_ADAPTIVE, QUALITY_MANUAL };
+
+struct QualitySettings
+{
+    GLint saoSamples;
+    GLint saoTurns;
+    GLint saoBlurSize;
+    GLint motionBlurMaxSamples;
+};
+
+QualitySettings qualityPresets[3] = {
+    { 4, 3, 2, 8 },             // low, also the lower bounds of the governor
+    { 8, 5, 4, 16 },            // medium
+    { 16, 9, 6, 32 }            // high, also the upper bounds
+};
+
+struct QualityGovernor
+{
+    GLint preset = QUALITY_ADAPTIVE;
+    GLfloat saoLevel = 1.0f;                // between the presets, 0 low, 1 medium, 2 high
+    GLfloat postprocessLevel = 1.0f;
+    GLfloat saoBudget = 1.5f;               // ms, at full resolution so the governor does not fight the resolution scaling
+    GLfloat postprocessBudget = 1.0f;       // ms, the post-processing always runs at the viewport size
+} quality;
 
 Model objectModel;
 
 
 Shape quadRender;
-Shape envCubeRender;
 
 // Addable Objects
 Model planeModel;
@@ -192,6 +339,8 @@ Model backPackModel;
 Model porcheModel;
 Model floorModel;
 
+ModelLoader modelLoader;
+
 int selected_hierarchy_node = 0;    // select the scene on start
 int gizmoType = 0;
 bool mouseHoveringViewport = false;
@@ -205,8 +354,7 @@ bool showPointLightSource = true;
 void carScene() 
 {
     changeSceneCar = false;
-    envMapHDR.setTextureHDR("resources/textures/hdr/city.hdr", "cityHDR", true);            // Road
-    iblSetup();
+    iblLoad("resources/textures/hdr/city.hdr", "cityHDR");                      // Road
     ambientIntensity = 4.0f;
     directionalLightIntensity = 0.0f;
     for (auto it = scene.children.begin(); it != scene.children.end(); it)
@@ -269,10 +417,16 @@ void renderImage() {
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
     //std::cout << "Current path is " << filesystem::current_path().string() << '\n';
     printf("Root Path: %s\n", std::filesystem::current_path().string().c_str());
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--check-formats")
+            formatCheckMode = true;
+    }
     
     // ------------------------------
     // glfw: initialize and configure
@@ -281,6 +435,8 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (formatCheckMode)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);                      // nothing to look at, the result goes to the console
 
 
     // --------------------
@@ -371,15 +527,33 @@ int main()
     // Shader(s)
     //----------
     gBufferShader.setShader("resources/shaders/gBuffer.vert", "resources/shaders/gBuffer.frag");
+    gBufferCompactShader.setShader("resources/shaders/gBuffer.vert", "resources/shaders/gBufferCompact.frag");
     saoShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/sao.frag");
     saoBlurShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoBlur.frag");
-    latlongToCubeShader.setShader("resources/shaders/latlongToCube.vert", "resources/shaders/latlongToCube.frag");
-    irradianceIBLShader.setShader("resources/shaders/lighting/irradianceIBL.vert", "resources/shaders/lighting/irradianceIBL.frag");
-    prefilterIBLShader.setShader("resources/shaders/lighting/prefilterIBL.vert", "resources/shaders/lighting/prefilterIBL.frag");
+    saoDownsampleShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoDownsample.frag");
+    saoUpsampleShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoUpsample.frag");
+    saoDepthMipShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoDepthMip.frag");
+    saoTemporalShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoTemporal.frag");
+    motionBlurTileMaxShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/motionBlurTileMax.frag");
+    motionBlurNeighborMaxShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/motionBlurNeighborMax.frag");
+    latlongToCubeShader.setShader("resources/shaders/lighting/cubeLayered.vert", "resources/shaders/lighting/cubeLayered.geom", "resources/shaders/latlongToCube.frag");
+    prefilterIBLShader.setShader("resources/shaders/lighting/cubeLayered.vert", "resources/shaders/lighting/cubeLayered.geom", "resources/shaders/lighting/prefilterIBL.frag");
     integrateIBLShader.setShader("resources/shaders/lighting/integrateIBL.vert", "resources/shaders/lighting/integrateIBL.frag");
     lightingBRDFShader.setShader("resources/shaders/lighting/lightingBRDF.vert", "resources/shaders/lighting/lightingBRDF.frag");
     firstpassPPShader.setShader("resources/shaders/postprocess/postprocess.vert", "resources/shaders/postprocess/firstpass.frag");
     simpleShader.setShader("resources/shaders/lighting/simple.vert", "resources/shaders/lighting/simple.frag");
+
+    computeSupported = GLAD_GL_VERSION_4_3;
+    if (computeSupported)
+    {
+        latlongToCubeComputeShader.setComputeShader("resources/shaders/latlongToCube.comp");
+        prefilterIBLComputeShader.setComputeShader("resources/shaders/lighting/prefilterIBL.comp");
+        saoBlurComputeShader.setComputeShader("resources/shaders/postprocess/saoBlur.comp");
+        firstpassPPComputeShader.setComputeShader("resources/shaders/postprocess/firstpass.comp");
+    }
+    iblComputeMode = computeSupported;
+    saoBlurComputeMode = computeSupported;
+    postprocessComputeMode = computeSupported;
     cout << "Shaders Compiled \n";
 
 
@@ -388,18 +562,27 @@ int main()
     // -----------
     // Environment Map HDRI Setup
     // --------------------------
-    envMapHDR.setTextureHDR("resources/textures/hdr/canyon.hdr", "canyonHDR", true);
-    envMapCube.setTextureCube(512, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
-    envMapIrradiance.setTextureCube(32, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR);
-    envMapPrefilter.setTextureCube(128, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
+    // RGBA16F, the image format the compute bake writes (there is no 3 channel image format)
+    envMapCube.setTextureCube(iblBakeSettings.cubeSize, GL_RGBA, GL_RGBA16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
+    envMapPrefilter.setTextureCube(iblBakeSettings.prefilterSize, GL_RGBA, GL_RGBA16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
     envMapPrefilter.computeTexMipmap();
-    envMapLUT.setTextureHDR(512, 512, GL_RG, GL_RG16F, GL_FLOAT, GL_LINEAR);
+    envMapPrefilterNext.setTextureCube(iblBakeSettings.prefilterSize, GL_RGBA, GL_RGBA16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
+    envMapPrefilterNext.computeTexMipmap();
+
+    // Only the prefiltered levels are ever specified again (bake or cache), the cache stores them as RGB16F
+    // so the levels past them would leave the texture incomplete with mixed formats
+    for (GLuint texture : { envMapPrefilter.getTexID(), envMapPrefilterNext.getTexID() })
+    {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, iblBakeSettings.prefilterLevels - 1);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    envMapLUT.setTextureHDR(iblBakeSettings.lutSize, iblBakeSettings.lutSize, GL_RG, GL_RG16F, GL_FLOAT, GL_LINEAR);
 
 
     //---------------
     // Shape(s)
     //---------------
-    envCubeRender.setShape("cube", glm::vec3(0.0f));
     quadRender.setShape("quad", glm::vec3(0.0f));
 
 
@@ -410,27 +593,20 @@ int main()
     // ---------------------
     // Models Initialization
     // ---------------------
-    // It is initialized here because it needs the glad loader to finish for it to work
-    // Also doesn't work when this is called from outside the function from where it is declared
+    // Models are parsed on worker threads and uploaded across the first frames (see modelLoader.update in the render loop),
+    // so the window comes up right away and the entities appear as soon as their model is ready
     // -------------------------------------------------
-    planeModel = Model(FileSystem::getPath("resources/objects/primitives/plane.obj"));
-    cubeModel = Model(FileSystem::getPath("resources/objects/primitives/cube.obj"));
-    sphereModel = Model(FileSystem::getPath("resources/objects/primitives/sphere.obj"));
-    cylinderModel = Model(FileSystem::getPath("resources/objects/primitives/cylinder.obj"));
-    cout << "Primitive Models Loaded\n";
-    floorModel = Model(FileSystem::getPath("resources/objects/floor/floor.obj"));
-    cout << "Floor Model Loaded\n";
-    planetModel = Model(FileSystem::getPath("resources/objects/planet/planet.obj"));
-    cout << "Planet Model Loaded\n";
-    rockModel = Model(FileSystem::getPath("resources/objects/rock/rock.obj"));
-    cout << "Rock Model Loaded\n";
-    cyborgModel = Model(FileSystem::getPath("resources/objects/cyborg/cyborg.obj"));
-    cout << "Cyborg Model Loaded\n";
-    backPackModel = Model(FileSystem::getPath("resources/objects/backpack/backpack.obj"));
-    cout << "Backpack Model Loaded\n";
-    porcheModel = Model(FileSystem::getPath("resources/objects/porche/porche.obj"));
-    cout << "Car Model Loaded\n";
-    std::cout << "Loaded all Models" << "\n";
+    modelLoader.load(planeModel, FileSystem::getPath("resources/objects/primitives/plane.obj"), "Plane");
+    modelLoader.load(cubeModel, FileSystem::getPath("resources/objects/primitives/cube.obj"), "Cube");
+    modelLoader.load(sphereModel, FileSystem::getPath("resources/objects/primitives/sphere.obj"), "Sphere");
+    modelLoader.load(cylinderModel, FileSystem::getPath("resources/objects/primitives/cylinder.obj"), "Cylinder");
+    modelLoader.load(floorModel, FileSystem::getPath("resources/objects/floor/floor.obj"), "Floor");
+    modelLoader.load(planetModel, FileSystem::getPath("resources/objects/planet/planet.obj"), "Planet");
+    modelLoader.load(rockModel, FileSystem::getPath("resources/objects/rock/rock.obj"), "Rock");
+    modelLoader.load(cyborgModel, FileSystem::getPath("resources/objects/cyborg/cyborg.obj"), "Cyborg");
+    modelLoader.load(backPackModel, FileSystem::getPath("resources/objects/backpack/backpack.obj"), "Backpack");
+    modelLoader.load(porcheModel, FileSystem::getPath("resources/objects/porche/porche.obj"), "Car");
+    std::cout << "Queued all Models" << "\n";
 
 
     //---------------------------------------------------------
@@ -441,9 +617,10 @@ int main()
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gAlbedo"), 1);
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gNormal"), 2);
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gEffects"), 3);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gDepth"), 6);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gMaterial"), 9);
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "sao"), 4);
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "envMap"), 5);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "envMapIrradiance"), 6);
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "envMapPrefilter"), 7);
     glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "envMapLUT"), 8);
 
@@ -451,23 +628,91 @@ int main()
     saoShader.use();
     glUniform1i(glGetUniformLocation(saoShader.ID, "gPosition"), 0);
     glUniform1i(glGetUniformLocation(saoShader.ID, "gNormal"), 1);
+    glUniform1i(glGetUniformLocation(saoShader.ID, "saoDepth"), 2);
+
+
+    saoDepthMipShader.use();
+    glUniform1i(glGetUniformLocation(saoDepthMipShader.ID, "depthInput"), 0);
+
+
+    saoTemporalShader.use();
+    glUniform1i(glGetUniformLocation(saoTemporalShader.ID, "saoInput"), 0);
+    glUniform1i(glGetUniformLocation(saoTemporalShader.ID, "saoDepth"), 1);
+    glUniform1i(glGetUniformLocation(saoTemporalShader.ID, "saoHistory"), 2);
+    glUniform1i(glGetUniformLocation(saoTemporalShader.ID, "gEffects"), 3);
+
+
+    saoBlurShader.use();
+    glUniform1i(glGetUniformLocation(saoBlurShader.ID, "saoInput"), 0);
+    glUniform1i(glGetUniformLocation(saoBlurShader.ID, "saoDepth"), 1);
+    glUniform1i(glGetUniformLocation(saoBlurShader.ID, "saoNormal"), 2);
+
+
+    if (computeSupported)
+    {
+        saoBlurComputeShader.use();
+        glUniform1i(glGetUniformLocation(saoBlurComputeShader.ID, "saoInput"), 0);
+        glUniform1i(glGetUniformLocation(saoBlurComputeShader.ID, "saoDepth"), 1);
+        glUniform1i(glGetUniformLocation(saoBlurComputeShader.ID, "saoNormal"), 2);
+    }
+
+
+    saoDownsampleShader.use();
+    glUniform1i(glGetUniformLocation(saoDownsampleShader.ID, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(saoDownsampleShader.ID, "gNormal"), 1);
+    glUniform1i(glGetUniformLocation(saoDownsampleShader.ID, "gDepth"), 2);
+
+
+    saoUpsampleShader.use();
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.ID, "saoInput"), 0);
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.ID, "saoPosition"), 1);
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.ID, "gPosition"), 2);
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.ID, "gDepth"), 3);
 
 
     firstpassPPShader.use();
     glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "sao"), 1);
     glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "gEffects"), 2);
+    glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "gDepth"), 3);
+    glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "motionBlurNeighborMax"), 4);
+    glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "motionBlurTileSize"), motionBlurTileSize);
 
 
-    latlongToCubeShader.use();
-    glUniform1i(glGetUniformLocation(latlongToCubeShader.ID, "envMap"), 0);
+    motionBlurTileMaxShader.use();
+    glUniform1i(glGetUniformLocation(motionBlurTileMaxShader.ID, "gEffects"), 0);
+    glUniform1i(glGetUniformLocation(motionBlurTileMaxShader.ID, "motionBlurTileSize"), motionBlurTileSize);
+
 
+    motionBlurNeighborMaxShader.use();
+    glUniform1i(glGetUniformLocation(motionBlurNeighborMaxShader.ID, "tileMax"), 0);
 
-    irradianceIBLShader.use();
-    glUniform1i(glGetUniformLocation(irradianceIBLShader.ID, "envMap"), 0);
+
+    latlongToCubeShader.use();
+    glUniform1i(glGetUniformLocation(latlongToCubeShader.ID, "envMap"), 0);
 
 
     prefilterIBLShader.use();
     glUniform1i(glGetUniformLocation(prefilterIBLShader.ID, "envMap"), 0);
+    glUniformBlockBinding(prefilterIBLShader.ID, glGetUniformBlockIndex(prefilterIBLShader.ID, "PrefilterSamples"), 0);
+
+
+    if (computeSupported)
+    {
+        latlongToCubeComputeShader.use();
+        glUniform1i(glGetUniformLocation(latlongToCubeComputeShader.ID, "envMap"), 0);
+
+        prefilterIBLComputeShader.use();
+        glUniform1i(glGetUniformLocation(prefilterIBLComputeShader.ID, "envMap"), 0);
+        glUniformBlockBinding(prefilterIBLComputeShader.ID, glGetUniformBlockIndex(prefilterIBLComputeShader.ID, "PrefilterSamples"), 0);
+
+        firstpassPPComputeShader.use();
+        glUniform1i(glGetUniformLocation(firstpassPPComputeShader.ID, "screenTexture"), 0);
+        glUniform1i(glGetUniformLocation(firstpassPPComputeShader.ID, "sao"), 1);
+        glUniform1i(glGetUniformLocation(firstpassPPComputeShader.ID, "gEffects"), 2);
+        glUniform1i(glGetUniformLocation(firstpassPPComputeShader.ID, "gDepth"), 3);
+        glUniform1i(glGetUniformLocation(firstpassPPComputeShader.ID, "motionBlurNeighborMax"), 4);
+        glUniform1i(glGetUniformLocation(firstpassPPComputeShader.ID, "motionBlurTileSize"), motionBlurTileSize);
+    }
 
 
     // --------------------
@@ -476,8 +721,23 @@ int main()
     gBufferSetup();     // G-Buffer setup
     saoSetup();         // SAO setup
     postprocessSetup(); // Postprocessing setup
+    motionBlurSetup();
     screenSetup();      // Screen setup
-    iblSetup();         // IBL setup
+    iblBakeSettings.shaderHash = getIBLShaderHash(getIBLBakeShaders());
+
+    // GGX samples of each prefilter level, the uniform block always has its full declared size
+    for (GLuint mip = 0; mip < iblBakeSettings.prefilterLevels; mip++)
+    {
+        float roughness = (float)mip / (float)(iblBakeSettings.prefilterLevels - 1);
+        prefilterSampleTables.push_back(buildPrefilterSamples(roughness, iblBakeSettings.cubeSize, getPrefilterSampleCount(roughness)));
+    }
+    glGenBuffers(1, &prefilterSampleUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, prefilterSampleUBO);
+    glBufferData(GL_UNIFORM_BUFFER, 1024 * sizeof(PrefilterSample), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, prefilterSampleUBO);
+
+    brdfLUTSetup();     // BRDF LUT, independent of the environment, checked against integrateIBL.frag
 
 
     //------------------------------
@@ -510,6 +770,7 @@ int main()
     // Load Scene
     // ----------
     carScene();
+    iblFinish();        // the first environment is baked before the first frame
 
 
     // -----------
@@ -533,6 +794,13 @@ int main()
         processInput(window);   // User input given to window created by glfw
 
 
+        modelLoader.update(modelUploadBudget);  // Upload the models streamed in by the worker threads
+        TextureStreamer::instance().update(textureStreamBudget);   // Stream the finer mips of their textures
+        TextureCache::instance().collect();                         // Delete the textures no mesh uses anymore
+        RenderTargetPool::instance().endFrame();                    // Free the render targets left over by a resize
+        iblUpdate(iblBakeBudget);                                   // Bake the environment switched to, the previous one stays on screen
+
+
         scene.updateSelfAndChild(); // Update model transforms changed in previouse frame
 
 
@@ -543,22 +811,40 @@ int main()
         glm::mat4 view = camera.GetViewMatrix();
         const Frustum camFrustum = createFrustumFromCamera(camera, (float)viewportWidth / (float)viewportHeight, glm::radians(camera.Zoom), 0.1f, 100.0f);
 
+        // Internal resolution: the geometry, SAO and lighting passes draw into the bottom left part of their targets,
+        // allocated at the viewport size, and the post-processing upscales it to the viewport
+        GLuint renderWidth = std::max((GLuint)(viewportWidth * renderScale + 0.5f), 1u);
+        GLuint renderHeight = std::max((GLuint)(viewportHeight * renderScale + 0.5f), 1u);
+        glm::vec2 renderUVScale = glm::vec2((float)renderWidth / viewportWidth, (float)renderHeight / viewportHeight);
+
+        // Depth buffer to view space, for the passes reading the compact G-buffer
+        glm::vec4 gBufferProjInfo = glm::vec4(projection[0][0], projection[1][1], projection[2][0], projection[2][1]);
+        glm::vec2 gBufferDepthInfo = glm::vec2(projection[2][2], projection[3][2]);
+
 
         //------------------------
         // Geometry Pass rendering
         //------------------------
         glQueryCounter(queryIDGeometry[0], GL_TIMESTAMP);   // Start geometry pass timer
         glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);         // Binding the framebuffer to gBuffer object so that the shader outputs to buffers inside gBuffer object
+        glViewport(0, 0, renderWidth, renderHeight);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-        gBufferShader.use();                                                                                                // Setting up resources used by gBufferShader
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));      // Camera Projection
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));                  // Camera View
-        glUniform3f(glGetUniformLocation(gBufferShader.ID, "albedoColor"), albedoColor.r, albedoColor.g, albedoColor.b);        // Default albedo Color white
+        Shader& geometryShader = gBufferCompactMode ? gBufferCompactShader : gBufferShader;
+        geometryShader.use();                                                                                               // Setting up resources used by gBufferShader
+        glUniformMatrix4fv(glGetUniformLocation(geometryShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));     // Camera Projection
+        glUniformMatrix4fv(glGetUniformLocation(geometryShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));                 // Camera View
+        glm::mat4 viewProjection = projection * view;
+        if (!prevViewProjectionValid)
+            prevViewProjection = viewProjection;
+        prevViewProjectionValid = true;
+        glUniformMatrix4fv(glGetUniformLocation(geometryShader.ID, "prevViewProjection"), 1, GL_FALSE, glm::value_ptr(prevViewProjection));    // Camera of the last frame, velocity
+        prevViewProjection = viewProjection;
+        glUniform3f(glGetUniformLocation(geometryShader.ID, "albedoColor"), albedoColor.r, albedoColor.g, albedoColor.b);       // Default albedo Color white
 
 
-        scene.drawSelfAndChild(camFrustum, gBufferShader, displayedModels, totalModelsInScene);  // Draw our Scene Graph while passing remaining resources to the shader
+        scene.drawSelfAndChild(camFrustum, geometryShader, displayedModels, totalModelsInScene);  // Draw our Scene Graph while passing remaining resources to the shader
 
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);               // Resets the non rendering framebuffer to direct to window framebuffer
@@ -569,6 +855,67 @@ int main()
         // SAO rendering
         //---------------
         glQueryCounter(queryIDSAO[0], GL_TIMESTAMP);    // Start SAO pass timer
+        GLuint saoWidth = std::max(renderWidth / saoResolution, 1u);
+        GLuint saoHeight = std::max(renderHeight / saoResolution, 1u);
+        bool saoConverted = saoResolution > 1 || gBufferCompactMode;   // SAO reads saoPosition / saoNormal, not the G-buffer
+
+        if (saoMode && saoConverted)
+        {
+            // One position / normal per block of pixels, picked from the G-buffer
+            glBindFramebuffer(GL_FRAMEBUFFER, saoDownsampleFBO);
+            glViewport(0, 0, saoWidth, saoHeight);
+
+            saoDownsampleShader.use();
+            glUniform1i(glGetUniformLocation(saoDownsampleShader.ID, "saoResolution"), saoResolution);
+            glUniform1i(glGetUniformLocation(saoDownsampleShader.ID, "gBufferCompact"), gBufferCompactMode);
+            glUniform4fv(glGetUniformLocation(saoDownsampleShader.ID, "gBufferProjInfo"), 1, glm::value_ptr(gBufferProjInfo));
+            glUniform2fv(glGetUniformLocation(saoDownsampleShader.ID, "gBufferDepthInfo"), 1, glm::value_ptr(gBufferDepthInfo));
+            glUniform2i(glGetUniformLocation(saoDownsampleShader.ID, "renderSize"), renderWidth, renderHeight);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gPosition);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, gNormal);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, gDepth);
+            quadRender.drawShape();
+        }
+
+        if (saoMode)
+        {
+            // Camera space z pyramid of the positions SAO runs on, level 0 copied from them, then one level per draw
+            glBindFramebuffer(GL_FRAMEBUFFER, saoDepthFBO);
+            saoDepthMipShader.use();
+            glUniform1i(glGetUniformLocation(saoDepthMipShader.ID, "fromPosition"), true);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, saoConverted ? saoPosition : gPosition);
+
+            for (GLuint level = 0; level < saoDepthLevels; level++)
+            {
+                if (level == 1)
+                {
+                    glUniform1i(glGetUniformLocation(saoDepthMipShader.ID, "fromPosition"), false);
+                    glBindTexture(GL_TEXTURE_2D, saoDepthBuffer);
+                }
+
+                // only the previous level is in the sampled range, the one being written is not a feedback loop
+                if (level > 0)
+                {
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+                    glUniform2i(glGetUniformLocation(saoDepthMipShader.ID, "previousSize"), std::max(saoWidth >> (level - 1), 1u), std::max(saoHeight >> (level - 1), 1u));
+                }
+
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoDepthBuffer, level);
+                glViewport(0, 0, std::max(saoWidth >> level, 1u), std::max(saoHeight >> level, 1u));
+                quadRender.drawShape();
+            }
+
+            glBindTexture(GL_TEXTURE_2D, saoDepthBuffer);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, saoDepthLevels - 1);
+            glViewport(0, 0, saoWidth, saoHeight);
+        }
+
         glBindFramebuffer(GL_FRAMEBUFFER, saoFBO);
         glClear(GL_COLOR_BUFFER_BIT);
 
@@ -578,9 +925,11 @@ int main()
             // SAO noisy texture
             saoShader.use();
             glActiveTexture(GL_TEXTURE0);                                                       // Setting up resources used by saoShader
-            glBindTexture(GL_TEXTURE_2D, gPosition);                                                // pass gPosition texture from gBuffer to sao shader (generated by geometry pass)
+            glBindTexture(GL_TEXTURE_2D, saoConverted ? saoPosition : gPosition);                   // pass gPosition texture from gBuffer to sao shader (generated by geometry pass)
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);                                                  // pass gNormal texture from gBuffer to sao shader (generated by geometry pass)
+            glBindTexture(GL_TEXTURE_2D, saoConverted ? saoNormal : gNormal);                       // pass gNormal texture from gBuffer to sao shader (generated by geometry pass)
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, saoDepthBuffer);                                           // camera space z pyramid, for the samples
             glUniform1i(glGetUniformLocation(saoShader.ID, "saoSamples"), saoSamples);              // setting sao variables ...
             glUniform1f(glGetUniformLocation(saoShader.ID, "saoRadius"), saoRadius);
             glUniform1i(glGetUniformLocation(saoShader.ID, "saoTurns"), saoTurns);
@@ -589,26 +938,112 @@ int main()
             glUniform1f(glGetUniformLocation(saoShader.ID, "saoContrast"), saoContrast);
             glUniform1i(glGetUniformLocation(saoShader.ID, "viewportWidth"), viewportWidth);
             glUniform1i(glGetUniformLocation(saoShader.ID, "viewportHeight"), viewportHeight);
+            glUniform1i(glGetUniformLocation(saoShader.ID, "saoResolution"), saoResolution);
+            glUniform4f(glGetUniformLocation(saoShader.ID, "saoProjInfo"),                         // reconstructs the samples from their z
+                        -2.0f / (saoWidth * projection[0][0]), -2.0f / (saoHeight * projection[1][1]),
+                        (1.0f - projection[2][0]) / projection[0][0], (1.0f + projection[2][1]) / projection[1][1]);
+            glUniform2i(glGetUniformLocation(saoShader.ID, "saoRenderSize"), saoWidth, saoHeight);
+            glUniform1f(glGetUniformLocation(saoShader.ID, "saoPhiOffset"), saoTemporalMode ? ((formatDiffStep != 0 ? saoFrameIndex : saoFrameIndex++) % 16) * 2.39996f : 0.0f);   // golden angle steps, held while comparing the formats
             quadRender.drawShape();                                                             // Apply saoShader over the whole screen
 
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 
-            // SAO blur pass
-            glBindFramebuffer(GL_FRAMEBUFFER, saoBlurFBO);  // Separate frame buffer object for blurred SAO
-            glClear(GL_COLOR_BUFFER_BIT);
+            // SAO temporal accumulation, blends this frame's samples into the reprojected history
+            GLuint saoFiltered = saoBuffer;
+            if (saoTemporalMode)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, saoHistoryFBO[saoHistoryIndex]);
+
+                saoTemporalShader.use();
+                glUniform1i(glGetUniformLocation(saoTemporalShader.ID, "saoHistoryValid"), saoHistoryValid && formatDiffStep == 0);   // each compared frame on its own samples
+                glUniform1f(glGetUniformLocation(saoTemporalShader.ID, "saoTemporalBlend"), saoTemporalBlend);
+                glUniform1i(glGetUniformLocation(saoTemporalShader.ID, "gBufferCompact"), gBufferCompactMode);
+                glUniform2fv(glGetUniformLocation(saoTemporalShader.ID, "renderScale"), 1, glm::value_ptr(renderUVScale));
+                glUniform2iv(glGetUniformLocation(saoTemporalShader.ID, "saoHistorySize"), 1, glm::value_ptr(saoHistorySize));
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, saoBuffer);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, saoDepthBuffer);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, saoHistoryBuffer[1 - saoHistoryIndex]);
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, gEffects);
+                quadRender.drawShape();
+
+                saoFiltered = saoHistoryBuffer[saoHistoryIndex];
+                saoHistoryIndex = 1 - saoHistoryIndex;
+                saoHistorySize = glm::ivec2(saoWidth, saoHeight);
+            }
+            saoHistoryValid = saoTemporalMode;
 
 
-            saoBlurShader.use();
-            glUniform1i(glGetUniformLocation(saoBlurShader.ID, "saoBlurSize"), saoBlurSize);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, saoBuffer);
-            quadRender.drawShape();
+            // SAO blur passes, separable: horizontal into saoBlurTempBuffer, vertical into saoBlurBuffer
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, saoDepthBuffer);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, saoConverted ? saoNormal : gNormal);
+
+            const GLuint blurInputs[2] = { saoFiltered, saoBlurTempBuffer };
+            const GLuint blurOutputs[2] = { saoBlurTempBuffer, saoBlurBuffer };
+            const GLuint blurFBOs[2] = { saoBlurTempFBO, saoBlurFBO };
+
+            for (int pass = 0; pass < 2; pass++)
+            {
+                const Shader& blurShader = saoBlurComputeMode ? saoBlurComputeShader : saoBlurShader;
+                blurShader.use();
+                glUniform1i(glGetUniformLocation(blurShader.ID, "saoBlurSize"), saoBlurSize);
+                glUniform2i(glGetUniformLocation(blurShader.ID, "saoBlurDirection"), pass == 0, pass == 1);
+                glUniform2i(glGetUniformLocation(blurShader.ID, "saoRenderSize"), saoWidth, saoHeight);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, blurInputs[pass]);
+
+                if (saoBlurComputeMode)
+                {
+                    // one work group per run of 128 texels of a line, lines along the axis of the pass
+                    glBindImageTexture(0, blurOutputs[pass], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+                    GLuint lineLength = pass == 0 ? saoWidth : saoHeight;
+                    glDispatchCompute((lineLength + 127) / 128, pass == 0 ? saoHeight : saoWidth, 1);
+                    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+                }
+                else
+                {
+                    glBindFramebuffer(GL_FRAMEBUFFER, blurFBOs[pass]);
+                    quadRender.drawShape();
+                }
+            }
+
+
+            // Back to full resolution, edge aware
+            if (saoResolution > 1)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, saoUpsampleFBO);
+                glViewport(0, 0, renderWidth, renderHeight);
+
+                saoUpsampleShader.use();
+                glUniform1i(glGetUniformLocation(saoUpsampleShader.ID, "gBufferCompact"), gBufferCompactMode);
+                glUniform4fv(glGetUniformLocation(saoUpsampleShader.ID, "gBufferProjInfo"), 1, glm::value_ptr(gBufferProjInfo));
+                glUniform2fv(glGetUniformLocation(saoUpsampleShader.ID, "gBufferDepthInfo"), 1, glm::value_ptr(gBufferDepthInfo));
+                glUniform2fv(glGetUniformLocation(saoUpsampleShader.ID, "renderScale"), 1, glm::value_ptr(renderUVScale));
+                glUniform2i(glGetUniformLocation(saoUpsampleShader.ID, "saoRenderSize"), saoWidth, saoHeight);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, saoPosition);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, gPosition);
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, gDepth);
+                quadRender.drawShape();
+            }
         }
+        else
+            saoHistoryValid = false;
 
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, renderWidth, renderHeight);
         glQueryCounter(queryIDSAO[1], GL_TIMESTAMP);    // Stop SAO pass timer
 
 
@@ -629,12 +1064,14 @@ int main()
         glBindTexture(GL_TEXTURE_2D, gNormal);              // Normal & Metalness (in .a)
         glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_2D, gEffects);             // Texture Ambient Occlusion
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, gDepth);               // Depth, position of the compact layout
+        glActiveTexture(GL_TEXTURE9);
+        glBindTexture(GL_TEXTURE_2D, gMaterial);            // Metalness & Ambient Occlusion of the compact layout
         glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);        // Screenspace AO
+        glBindTexture(GL_TEXTURE_2D, saoResult);            // Screenspace AO
         glActiveTexture(GL_TEXTURE5);
         envMapHDR.useTexture();                             // Environment Map for background
-        glActiveTexture(GL_TEXTURE6);
-        envMapIrradiance.useTexture();                      // Environment Map sample for ambient lighting
         glActiveTexture(GL_TEXTURE7);
         envMapPrefilter.useTexture();                       // Env MipMap 
         glActiveTexture(GL_TEXTURE8);
@@ -664,6 +1101,10 @@ int main()
         glUniform3f(glGetUniformLocation(lightingBRDFShader.ID, "materialF0"), materialF0.r, materialF0.g, materialF0.b);                       // Sth to do with fresnel effect
         glUniform1f(glGetUniformLocation(lightingBRDFShader.ID, "ambientIntensity"), ambientIntensity);                                         // [ Not set up ]
         glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gBufferView"), gBufferView);                                                   // Choose differend debug view, eg: normal, SAO, metallic, etc.
+        glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "gBufferCompact"), gBufferCompactMode);                                         // G-buffer layout
+        glUniform4fv(glGetUniformLocation(lightingBRDFShader.ID, "gBufferProjInfo"), 1, glm::value_ptr(gBufferProjInfo));                       // Position from depth
+        glUniform2fv(glGetUniformLocation(lightingBRDFShader.ID, "gBufferDepthInfo"), 1, glm::value_ptr(gBufferDepthInfo));
+        glUniform2fv(glGetUniformLocation(lightingBRDFShader.ID, "renderScale"), 1, glm::value_ptr(renderUVScale));         // Rendered part of the G-buffer
         glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "pointMode"), pointMode);                                                       // Point light flag
         glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "directionalMode"), directionalMode);                                           // Directional light flag
         glUniform1i(glGetUniformLocation(lightingBRDFShader.ID, "iblMode"), iblMode);                                                           // Image Based Lighting flag
@@ -681,44 +1122,88 @@ int main()
         // Post-processing Pass rendering
         //-------------------------------
         glQueryCounter(queryIDPostprocess[0], GL_TIMESTAMP);    // Start post-processing pass timer
-        glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);           // Setting up the buffer object used my ImGui viewport to render scene
-        glClear(GL_COLOR_BUFFER_BIT);
 
-        firstpassPPShader.use();                                                                                                    // Setting up resources used by post processing
-        glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "gBufferView"), gBufferView);                                            // Used as debug view flag to skip post processing
-        glUniform2f(glGetUniformLocation(firstpassPPShader.ID, "screenTextureSize"), 1.0f / viewportWidth, 1.0f / viewportHeight);      // For FXAA offset calculation
-        glUniform1f(glGetUniformLocation(firstpassPPShader.ID, "cameraAperture"), cameraAperture);                                      // Physical camera aperture sim
-        glUniform1f(glGetUniformLocation(firstpassPPShader.ID, "cameraShutterSpeed"), cameraShutterSpeed);                              // Physical camera shutter speed sim
-        glUniform1f(glGetUniformLocation(firstpassPPShader.ID, "cameraISO"), cameraISO);                                                // Physical camera ISO sim
-        glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "saoMode"), saoMode);                                                    // SAO flag
-        glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "fxaaMode"), fxaaMode);                                                  // FXAA flag
-        glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "motionBlurMode"), motionBlurMode);                                      // Motion Blur Flag
-        glUniform1f(glGetUniformLocation(firstpassPPShader.ID, "motionBlurScale"), int(ImGui::GetIO().Framerate) / 60.0f);              // Motion Blur Scale
-        glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "motionBlurMaxSamples"), motionBlurMaxSamples);                          // Motion Blur Samples
-        glUniform1i(glGetUniformLocation(firstpassPPShader.ID, "tonemappingMode"), tonemappingMode);                                    // Tonemapping mode
+        if (motionBlurMode && gBufferView == 1)
+        {
+            // Longest velocity of each tile, then of the 3x3 tiles around it, read by the motion blur reconstruction
+            GLuint tileWidth = (renderWidth + motionBlurTileSize - 1) / motionBlurTileSize;
+            GLuint tileHeight = (renderHeight + motionBlurTileSize - 1) / motionBlurTileSize;
+            glViewport(0, 0, tileWidth, tileHeight);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, motionBlurTileFBO);
+            motionBlurTileMaxShader.use();
+            glUniform1i(glGetUniformLocation(motionBlurTileMaxShader.ID, "gBufferCompact"), gBufferCompactMode);
+            glUniform2i(glGetUniformLocation(motionBlurTileMaxShader.ID, "renderSize"), renderWidth, renderHeight);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gEffects);
+            quadRender.drawShape();
+
+            glBindFramebuffer(GL_FRAMEBUFFER, motionBlurNeighborFBO);
+            motionBlurNeighborMaxShader.use();
+            glUniform2i(glGetUniformLocation(motionBlurNeighborMaxShader.ID, "tileCount"), tileWidth, tileHeight);
+            glBindTexture(GL_TEXTURE_2D, motionBlurTileMax);
+            quadRender.drawShape();
+        }
+
+        Shader& postprocessShader = postprocessComputeMode ? firstpassPPComputeShader : firstpassPPShader;
+        postprocessShader.use();                                                                                                    // Setting up resources used by post processing
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "gBufferView"), gBufferView);                                            // Used as debug view flag to skip post processing
+        glUniform2f(glGetUniformLocation(postprocessShader.ID, "screenTextureSize"), 1.0f / viewportWidth, 1.0f / viewportHeight);      // For FXAA offset calculation
+        glUniform2fv(glGetUniformLocation(postprocessShader.ID, "renderScale"), 1, glm::value_ptr(renderUVScale));                      // Rendered part of the inputs
+        glUniform1f(glGetUniformLocation(postprocessShader.ID, "cameraAperture"), cameraAperture);                                      // Physical camera aperture sim
+        glUniform1f(glGetUniformLocation(postprocessShader.ID, "cameraShutterSpeed"), cameraShutterSpeed);                              // Physical camera shutter speed sim
+        glUniform1f(glGetUniformLocation(postprocessShader.ID, "cameraISO"), cameraISO);                                                // Physical camera ISO sim
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "saoMode"), saoMode);                                                    // SAO flag
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "gBufferCompact"), gBufferCompactMode);                                  // Velocity layout
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "fxaaMode"), fxaaMode);                                                  // FXAA flag
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "motionBlurMode"), motionBlurMode);                                      // Motion Blur Flag
+        glUniform1f(glGetUniformLocation(postprocessShader.ID, "motionBlurScale"), int(ImGui::GetIO().Framerate) / 60.0f);              // Motion Blur Scale
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "motionBlurMaxSamples"), motionBlurMaxSamples);                          // Motion Blur Samples
+        glUniform2fv(glGetUniformLocation(postprocessShader.ID, "gBufferDepthInfo"), 1, glm::value_ptr(gBufferDepthInfo));              // Depth of the blur samples
+        glUniform1i(glGetUniformLocation(postprocessShader.ID, "tonemappingMode"), tonemappingMode);                                    // Tonemapping mode
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, postprocessBuffer);    // Result of lighting pass sent for post-processing
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);        // SAO for post-processing
+        glBindTexture(GL_TEXTURE_2D, saoResult);            // SAO for post-processing
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, gEffects);             // Texture AO for post-processing
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, gDepth);               // Depth for the motion blur
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, motionBlurNeighborMax);    // Velocity around each tile for the motion blur
+
+        if (postprocessComputeMode)
+        {
+            // one work group per 16x16 tile of the viewport, written straight into screenBuffer
+            glBindImageTexture(0, screenBuffer, 0, GL_FALSE, 0, GL_WRITE_ONLY, screenFormat);
+            glDispatchCompute((viewportWidth + 15) / 16, (viewportHeight + 15) / 16, 1);
+            glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+        else
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);           // Setting up the buffer object used my ImGui viewport to render scene
+            glViewport(0, 0, viewportWidth, viewportHeight);        // Upscaled from the internal resolution
+            glClear(GL_COLOR_BUFFER_BIT);
 
-        quadRender.drawShape();                             // Apply post-processing on whole screen
+            quadRender.drawShape();                             // Apply post-processing on whole screen
+        }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, viewportWidth, viewportHeight);
         glQueryCounter(queryIDPostprocess[1], GL_TIMESTAMP);    // Stop post-processing pass timer
 
 
         //-----------------------
         // Forward Pass rendering
         //-----------------------
+        glQueryCounter(queryIDForward[0], GL_TIMESTAMP);    // Start timer for non PBR rendering
         glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, screenFBO); // write to default framebuffer
         // blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
         // the internal formats are implementation defined. This works on all of my systems, but if it doesn't on yours you'll likely have to write to the 		
         // depth buffer in another shader stage (or somehow see to match the default framebuffer's internal format with the FBO's internal format).
-        glBlitFramebuffer(0, 0, viewportWidth, viewportHeight, 0, 0, viewportWidth, viewportHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, viewportWidth, viewportHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);    // scaled up with the internal resolution
         
 
         // ------------------------------
@@ -738,6 +1223,15 @@ int main()
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glQueryCounter(queryIDForward[1], GL_TIMESTAMP);    // Stop timer for non PBR rendering
 
+        // --check-formats starts once nothing is left to stream in, so both compared frames show the same scene
+        if (formatCheckMode && formatDiffStep == 0 && formatDiffPSNR < 0.0f && viewportWidth > 0 && viewportHeight > 0 &&
+            modelLoader.pendingCount() == 0 && TextureStreamer::instance().getPendingCount() == 0 &&
+            !iblBake.decoding.valid() && iblBake.jobs.empty() && iblBake.fence == 0)
+            formatDiffStart();
+        formatDiffUpdate();                                 // Reads the finished frame back when comparing the target formats
+        if (formatCheckMode && formatDiffPSNR >= 0.0f)
+            glfwSetWindowShouldClose(window, true);
+
 
 #pragma region ImGUI Panels
         // -----------
@@ -1076,6 +1570,10 @@ int main()
                 ImGui::Text("Total Models :     %d", totalModelsInScene);
                 ImGui::Text("Displayed Models : %d", displayedModels);
                 ImGui::Text("Total Lights :     %d", totalLightsInScene);
+                ImGui::Text("Loading Models :   %d", modelLoader.pendingCount());
+                ImGui::Text("Cached Textures :  %d (%.1f MB)", TextureCache::instance().getTextureCount(), TextureCache::instance().getResidentBytes() / (1024.0f * 1024.0f));
+                ImGui::Text("Streaming Textures : %d (%.1f MB)", TextureStreamer::instance().getPendingCount(), TextureStreamer::instance().getPendingBytes() / (1024.0f * 1024.0f));
+                ImGui::Text("Render Targets :   %d (%.1f MB, %.1f MB pooled)", RenderTargetPool::instance().getLiveCount(), RenderTargetPool::instance().getLiveBytes() / (1024.0f * 1024.0f), RenderTargetPool::instance().getPooledBytes() / (1024.0f * 1024.0f));
                 ImGui::Unindent();
             }
             ImGui::Spacing();
@@ -1086,6 +1584,68 @@ int main()
             if (ImGui::CollapsingHeader("Profiling"))
             {
                 ImGui::Indent();
+                if (computeSupported)
+                    ImGui::Checkbox("Compute post-processing", &postprocessComputeMode);
+                if (ImGui::Checkbox("Compact G-Buffer", &gBufferCompactMode))
+                {
+                    gBufferSetup();
+                    saoSetup();
+                }
+
+                // Intermediate color targets, the lighting and post-processing passes write one each
+                const char* formatNames[3] = { "RGBA32F", "RGBA16F", "R11G11B10F" };
+                const GLenum formats[3] = { GL_RGBA32F, GL_RGBA16F, GL_R11F_G11F_B10F };
+                ImGui::Text("Lighting target");
+                for (int i = 0; i < 3; i++)
+                {
+                    ImGui::SameLine();
+                    if (ImGui::RadioButton((std::string(formatNames[i]) + "##lighting").c_str(), postprocessFormat == formats[i]))
+                    {
+                        postprocessFormat = formats[i];
+                        postprocessSetup();
+                    }
+                }
+                ImGui::Text("Post target    ");
+                for (int i = 0; i < 3; i++)
+                {
+                    ImGui::SameLine();
+                    if (ImGui::RadioButton((std::string(formatNames[i]) + "##post").c_str(), screenFormat == formats[i]))
+                    {
+                        screenFormat = formats[i];
+                        screenSetup();
+                    }
+                }
+                if (ImGui::Button("Compare with RGBA32F", { 150.0f, 25.0f }) && formatDiffStep == 0)
+                    formatDiffStart();
+                if (formatDiffPSNR >= 0.0f)
+                    ImGui::Text("PSNR : %.2f dB   Max error : %.5f", formatDiffPSNR, formatDiffMaxError);
+
+                // Sample counts of SAO and motion blur
+                const char* presetNames[5] = { "Low", "Medium", "High", "Adaptive", "Manual" };
+                for (int i = 0; i < 5; i++)
+                {
+                    if (i > 0)
+                        ImGui::SameLine();
+                    if (ImGui::RadioButton(presetNames[i], &quality.preset, i) && i <= QUALITY_HIGH)
+                        qualityApply((GLfloat)i, (GLfloat)i);
+                }
+                if (quality.preset == QUALITY_ADAPTIVE)
+                {
+                    ImGui::SliderFloat("SAO budget (ms)", &quality.saoBudget, 0.25f, 8.0f);
+                    ImGui::SliderFloat("Post budget (ms)", &quality.postprocessBudget, 0.25f, 8.0f);
+                }
+                ImGui::Text("SAO : %d samples, %d turns, blur radius %d", saoSamples, saoTurns, saoBlurSize);
+                ImGui::Text("Motion blur : %d samples", motionBlurMaxSamples);
+
+                ImGui::Checkbox("Dynamic resolution", &dynamicResolutionMode);
+                if (dynamicResolutionMode)
+                {
+                    ImGui::SliderFloat("Target GPU time (ms)", &dynamicResolutionTarget, 4.0f, 33.0f);
+                    ImGui::SliderFloat("Minimum scale", &renderScaleMin, 0.25f, 1.0f);
+                }
+                ImGui::Text("Internal resolution : %ux%u (%.0f %%)", std::max((GLuint)(viewportWidth * renderScale + 0.5f), 1u),
+                            std::max((GLuint)(viewportHeight * renderScale + 0.5f), 1u), renderScale * 100.0f);
+
                 ImGui::Text("Geometry Pass :    %.4f ms", deltaGeometryTime);
                 ImGui::Text("Lighting Pass :    %.4f ms", deltaLightingTime);
                 ImGui::Text("SAO Pass :         %.4f ms", deltaSAOTime);
@@ -1160,44 +1720,53 @@ int main()
                 ImGui::Indent();
                 if (ImGui::Button("Underpass", {150.0f, 25.0f}))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/underpass.hdr", "underpassHDR", true);  // Underpass
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/underpass.hdr", "underpassHDR");            // Underpass
                 }
                 if (ImGui::Button("Pisa", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/pisa.hdr", "pisaHDR", true);            // Pisa
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/pisa.hdr", "pisaHDR");                      // Pisa
                 }
                 if (ImGui::Button("Canyon", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/canyon.hdr", "canyonHDR", true);        // Canyon
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/canyon.hdr", "canyonHDR");                  // Canyon
                 }
                 if (ImGui::Button("Sunset", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/sunset.hdr", "sunsetHDR", true);        // Sunset
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/sunset.hdr", "sunsetHDR");                  // Sunset
                 }
                 if (ImGui::Button("Path", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/path.hdr", "pathHDR", true);            // Path
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/path.hdr", "pathHDR");                      // Path
                 }
                 if (ImGui::Button("Hills", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/hills.hdr", "hillsHDR", true);          // Hills
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/hills.hdr", "hillsHDR");                    // Hills
                 }
                 if (ImGui::Button("Road", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/road.hdr", "roadHDR", true);            // Road
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/road.hdr", "roadHDR");                      // Road
                 }
                 if (ImGui::Button("City", { 150.0f, 25.0f }))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/city.hdr", "cityHDR", true);            // City
-                    iblSetup();
+                    iblLoad("resources/textures/hdr/city.hdr", "cityHDR");                      // City
                 }
+
+                ImGui::Spacing();
+                if (!iblBake.jobs.empty() || iblBake.fence)
+                {
+                    float progress = 1.0f - (float)iblBake.jobs.size() / (float)std::max(iblBake.jobCount, (size_t)1);
+                    ImGui::Text("Baking %s", envMapHDRNext.getTexName().c_str());
+                    ImGui::ProgressBar(progress, { 150.0f, 0.0f });
+                }
+                ImGui::SliderFloat("Bake budget (ms)", &iblBakeBudget, 0.25f, 8.0f);
+                if (computeSupported)
+                    ImGui::Checkbox("Bake with compute shaders", &iblComputeMode);
+
+                ImGui::Spacing();
+                if (ImGui::Button("Validate BRDF LUT", { 150.0f, 25.0f }))
+                    brdfLUTValidate();
+                if (brdfLUTMaxError >= 0.0f)
+                    ImGui::Text("Max error : %.5f   Mean error : %.6f   %s", brdfLUTMaxError, brdfLUTMeanError, brdfLUTMaxError < 0.004f ? "passed" : "FAILED");
                 ImGui::Unindent();
             }
             ImGui::Spacing();
@@ -1222,13 +1791,29 @@ int main()
                 {
                     ImGui::Checkbox("Enable", &saoMode);
 
-                    ImGui::SliderInt("Samples", &saoSamples, 0, 64);
+                    GLint previousSAOResolution = saoResolution;
+                    ImGui::RadioButton("Full", &saoResolution, 1);
+                    ImGui::SameLine();
+                    ImGui::RadioButton("Half", &saoResolution, 2);
+                    ImGui::SameLine();
+                    ImGui::RadioButton("Quarter", &saoResolution, 4);
+                    if (saoResolution != previousSAOResolution)
+                        saoSetup();
+
+                    // the sample counts belong to the quality preset until one of them is edited here
+                    bool saoSamplesEdited = ImGui::SliderInt("Samples", &saoSamples, 0, 64);
+                    ImGui::Checkbox("Temporal", &saoTemporalMode);
+                    ImGui::SliderFloat("Temporal Blend", &saoTemporalBlend, 0.02f, 1.0f);
                     ImGui::SliderFloat("Radius", &saoRadius, 0.0f, 10.0f);
-                    ImGui::SliderInt("Turns", &saoTurns, 0, 16);
+                    saoSamplesEdited |= ImGui::SliderInt("Turns", &saoTurns, 0, 16);
                     ImGui::SliderFloat("Bias", &saoBias, 0.0f, 0.1f);
                     ImGui::SliderFloat("Scale", &saoScale, 0.0f, 3.0f);
                     ImGui::SliderFloat("Contrast", &saoContrast, 0.0f, 3.0f);
-                    ImGui::SliderInt("Blur Size", &saoBlurSize, 0, 8);
+                    saoSamplesEdited |= ImGui::SliderInt("Blur Radius", &saoBlurSize, 0, 16);
+                    if (saoSamplesEdited)
+                        quality.preset = QUALITY_MANUAL;
+                    if (computeSupported)
+                        ImGui::Checkbox("Compute blur", &saoBlurComputeMode);
 
                     ImGui::TreePop();
                 }
@@ -1291,8 +1876,8 @@ int main()
                 gBufferSetup();
                 saoSetup();
                 postprocessSetup();
+                motionBlurSetup();
                 screenSetup();
-                iblSetup();
             }
 
 
@@ -1398,6 +1983,10 @@ int main()
         deltaForwardTime = (stopForwardTime - startForwardTime) / 1000000.0;
         deltaGUITime = (stopGUITime - startGUITime) / 1000000.0;
 
+        if (formatDiffStep == 0)
+            qualityGovernorUpdate();                        // Sample counts of the next frame, before the resolution changes
+        dynamicResolutionUpdate();                          // Internal resolution of the next frame, from the timings of this one
+
 
         // -------------------------------------------------------------------------------
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -1417,63 +2006,83 @@ int main()
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    // Models and environments still loading are dropped, the jobs already running finish before the texture cache goes away
+    ThreadPool::shared().stop();
+
+    // GL resources of the singletons, their destructors run after the context is gone
+    TextureStreamer::instance().shutdown();
+    TextureCache::instance().release();
+
 
     // ------------------------------------------------------------------
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
+    if (formatCheckMode)
+        return formatDiffPSNR >= 40.0f ? 0 : 1;
     return 0;
 }
 
 
 void gBufferSetup()
 {
-    glGenFramebuffers(1, &gBuffer);
+    // Attachments come from the render target pool, the ones of the previous viewport size go back to it
+    RenderTargetPool& targetPool = RenderTargetPool::instance();
+    targetPool.releaseTexture(gPosition);
+    targetPool.releaseTexture(gAlbedo);
+    targetPool.releaseTexture(gNormal);
+    targetPool.releaseTexture(gMaterial);
+    targetPool.releaseTexture(gEffects);
+    targetPool.releaseTexture(gDepth);
+
+    if (!gBuffer)
+        glGenFramebuffers(1, &gBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
 
-    // Position
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, viewportWidth, viewportHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-    // Albedo + Roughness
-    glGenTextures(1, &gAlbedo);
-    glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, viewportWidth, viewportHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedo, 0);
-
-    // Normals + Metalness
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, viewportWidth, viewportHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gNormal, 0);
-
-    // Effects (AO + Velocity)
-    glGenTextures(1, &gEffects);
-    glBindTexture(GL_TEXTURE_2D, gEffects);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, viewportWidth, viewportHeight, 0, GL_RGB, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gEffects, 0);
+    if (gBufferCompactMode)
+    {
+        // Albedo + Roughness
+        gAlbedo = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gAlbedo, 0);
+
+        // Normals, octahedral
+        gNormal = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RG16, GL_RG, GL_UNSIGNED_SHORT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+
+        // Metalness + AO
+        gMaterial = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RG8, GL_RG, GL_UNSIGNED_BYTE));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gMaterial, 0);
+
+        // Effects (Velocity)
+        gEffects = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RG16F, GL_RG, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gEffects, 0);
+    }
+    else
+    {
+        // Position
+        gPosition = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RGBA16F, GL_RGBA, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
+
+        // Albedo + Roughness
+        gAlbedo = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedo, 0);
+
+        // Normals + Metalness
+        gNormal = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RGBA16F, GL_RGBA, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gNormal, 0);
+
+        // Effects (AO + Velocity)
+        gEffects = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_RGB16F, GL_RGB, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gEffects, 0);
+    }
 
     // Define the COLOR_ATTACHMENTS for the G-Buffer
     GLuint attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
     glDrawBuffers(4, attachments);
 
-    // Z-Buffer
-    glGenRenderbuffers(1, &zBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, zBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, viewportWidth, viewportHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, zBuffer);
+    // Z-Buffer, a texture: the compact layout reconstructs the positions from it
+    gDepth = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
 
     // Check if the framebuffer is complete before continuing
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -1483,53 +2092,131 @@ void gBufferSetup()
 
 void saoSetup()
 {
+    RenderTargetPool& targetPool = RenderTargetPool::instance();
+    targetPool.releaseTexture(saoBuffer);
+    targetPool.releaseTexture(saoBlurBuffer);
+    targetPool.releaseTexture(saoPosition);
+    targetPool.releaseTexture(saoNormal);
+    targetPool.releaseTexture(saoUpsampleBuffer);
+    targetPool.releaseTexture(saoDepthBuffer);
+    targetPool.releaseTexture(saoBlurTempBuffer);
+
+    // Occlusion and its blur run at the SAO resolution, brought back to the viewport by saoUpsample.frag
+    GLuint saoWidth = std::max(viewportWidth / saoResolution, 1u);
+    GLuint saoHeight = std::max(viewportHeight / saoResolution, 1u);
+
     // SAO Buffer
-    glGenFramebuffers(1, &saoFBO);
+    if (!saoFBO)
+        glGenFramebuffers(1, &saoFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, saoFBO);
-    glGenTextures(1, &saoBuffer);
-    glBindTexture(GL_TEXTURE_2D, saoBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, viewportWidth, viewportHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    saoBuffer = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_R8, GL_RED, GL_UNSIGNED_BYTE));
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoBuffer, 0);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "SAO Framebuffer not complete !" << std::endl;
 
-    // SAO Blur Buffer
-    glGenFramebuffers(1, &saoBlurFBO);
+    // SAO Blur Buffers, R8 (sized, the compute blur stores to them as images)
+    if (!saoBlurTempFBO)
+        glGenFramebuffers(1, &saoBlurTempFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, saoBlurTempFBO);
+    saoBlurTempBuffer = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_R8, GL_RED, GL_UNSIGNED_BYTE));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoBlurTempBuffer, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "SAO Blur Framebuffer not complete !" << std::endl;
+
+    if (!saoBlurFBO)
+        glGenFramebuffers(1, &saoBlurFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, saoBlurFBO);
-    glGenTextures(1, &saoBlurBuffer);
-    glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, viewportWidth, viewportHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    saoBlurBuffer = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_R8, GL_RED, GL_UNSIGNED_BYTE));
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoBlurBuffer, 0);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "SAO Blur Framebuffer not complete !" << std::endl;
 
+    // SAO Depth Pyramid, camera space z (one float, half the bytes of the positions) with its mip levels
+    saoDepthLevels = 1;
+    while (saoDepthLevels < saoMaxDepthLevels && (std::max(saoWidth, saoHeight) >> saoDepthLevels) > 0)
+        saoDepthLevels++;
+
+    if (!saoDepthFBO)
+        glGenFramebuffers(1, &saoDepthFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, saoDepthFBO);
+    saoDepthBuffer = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_R32F, GL_RED, GL_FLOAT, GL_NEAREST_MIPMAP_NEAREST, saoDepthLevels));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoDepthBuffer, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "SAO Depth Framebuffer not complete !" << std::endl;
+
+    // SAO History Buffers, the previous frame is gone once the size changes
+    for (int i = 0; i < 2; i++)
+    {
+        targetPool.releaseTexture(saoHistoryBuffer[i]);
+
+        if (!saoHistoryFBO[i])
+            glGenFramebuffers(1, &saoHistoryFBO[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, saoHistoryFBO[i]);
+        saoHistoryBuffer[i] = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_RG16F, GL_RG, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoHistoryBuffer[i], 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SAO History Framebuffer not complete !" << std::endl;
+    }
+    saoHistoryValid = false;
+
+    saoResult = saoBlurBuffer;
+
+    // the compact G-buffer has no position / normal SAO can read, they are converted at full resolution too
+    if (saoResolution > 1 || gBufferCompactMode)
+    {
+        // SAO Downsample Buffers (position with linear depth in .a, normal)
+        if (!saoDownsampleFBO)
+            glGenFramebuffers(1, &saoDownsampleFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, saoDownsampleFBO);
+        saoPosition = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_RGBA16F, GL_RGBA, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoPosition, 0);
+        saoNormal = targetPool.acquireTexture(RenderTargetDesc(saoWidth, saoHeight, GL_RGB16F, GL_RGB, GL_FLOAT));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, saoNormal, 0);
+
+        GLuint attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SAO Downsample Framebuffer not complete !" << std::endl;
+
+        // SAO Upsample Buffer
+        if (!saoUpsampleFBO)
+            glGenFramebuffers(1, &saoUpsampleFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, saoUpsampleFBO);
+        saoUpsampleBuffer = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, GL_R8, GL_RED, GL_UNSIGNED_BYTE));
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoUpsampleBuffer, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SAO Upsample Framebuffer not complete !" << std::endl;
+
+        saoResult = saoUpsampleBuffer;
+    }
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void screenSetup()
 {
+    RenderTargetPool& targetPool = RenderTargetPool::instance();
+    targetPool.releaseTexture(screenBuffer);
+    targetPool.releaseRenderbuffer(screenZBuffer);
+
     // Post-processing Buffer
-    glGenFramebuffers(1, &screenFBO);
+    if (!screenFBO)
+        glGenFramebuffers(1, &screenFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
 
-    glGenTextures(1, &screenBuffer);
-    glBindTexture(GL_TEXTURE_2D, screenBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, viewportWidth, viewportHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    screenBuffer = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, screenFormat, screenFormat == GL_R11F_G11F_B10F ? GL_RGB : GL_RGBA, GL_FLOAT));
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenBuffer, 0);
 
     // Z-Buffer
-    glGenRenderbuffers(1, &zBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, zBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, viewportWidth, viewportHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, zBuffer);
+    screenZBuffer = targetPool.acquireRenderbuffer(viewportWidth, viewportHeight, GL_DEPTH_COMPONENT24);     // same format as gDepth, blitted from it
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, screenZBuffer);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Postprocess Framebuffer not complete !" << std::endl;
@@ -1538,15 +2225,16 @@ void screenSetup()
 
 void postprocessSetup()
 {
+    RenderTargetPool& targetPool = RenderTargetPool::instance();
+    targetPool.releaseTexture(postprocessBuffer);
+
     // Post-processing Buffer
-    glGenFramebuffers(1, &postprocessFBO);
+    if (!postprocessFBO)
+        glGenFramebuffers(1, &postprocessFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, postprocessFBO);
 
-    glGenTextures(1, &postprocessBuffer);
-    glBindTexture(GL_TEXTURE_2D, postprocessBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, viewportWidth, viewportHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // linear, the post-processing upscales it from the internal resolution
+    postprocessBuffer = targetPool.acquireTexture(RenderTargetDesc(viewportWidth, viewportHeight, postprocessFormat, postprocessFormat == GL_R11F_G11F_B10F ? GL_RGB : GL_RGBA, GL_FLOAT, GL_LINEAR));
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, postprocessBuffer, 0);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -1554,125 +2242,636 @@ void postprocessSetup()
 }
 
 
-void iblSetup()
+void motionBlurSetup()
 {
-    // Latlong to Cubemap conversion
-    glGenFramebuffers(1, &envToCubeFBO);
-    glGenRenderbuffers(1, &envToCubeRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, envToCubeFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, envToCubeRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapCube.getTexWidth(), envMapCube.getTexHeight());
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, envToCubeRBO);
+    RenderTargetPool& targetPool = RenderTargetPool::instance();
+    targetPool.releaseTexture(motionBlurTileMax);
+    targetPool.releaseTexture(motionBlurNeighborMax);
 
-    latlongToCubeShader.use();
+    GLuint tileWidth = (viewportWidth + motionBlurTileSize - 1) / motionBlurTileSize;
+    GLuint tileHeight = (viewportHeight + motionBlurTileSize - 1) / motionBlurTileSize;
 
-    glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
-    glActiveTexture(GL_TEXTURE0);
-    envMapHDR.useTexture();
+    // Motion Blur Tile-Max Buffer
+    if (!motionBlurTileFBO)
+        glGenFramebuffers(1, &motionBlurTileFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, motionBlurTileFBO);
+
+    motionBlurTileMax = targetPool.acquireTexture(RenderTargetDesc(tileWidth, tileHeight, GL_RG16F, GL_RG, GL_FLOAT));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, motionBlurTileMax, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Motion Blur Tile Framebuffer not complete !" << std::endl;
 
-    glViewport(0, 0, envMapCube.getTexWidth(), envMapCube.getTexHeight());
-    glBindFramebuffer(GL_FRAMEBUFFER, envToCubeFBO);
+    // Motion Blur Neighbor-Max Buffer
+    if (!motionBlurNeighborFBO)
+        glGenFramebuffers(1, &motionBlurNeighborFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, motionBlurNeighborFBO);
 
-    for (unsigned int i = 0; i < 6; ++i)
+    motionBlurNeighborMax = targetPool.acquireTexture(RenderTargetDesc(tileWidth, tileHeight, GL_RG16F, GL_RG, GL_FLOAT));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, motionBlurNeighborMax, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Motion Blur Neighbor Framebuffer not complete !" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+void iblLoad(const char* path, std::string name)
+{
+    // The decode, the content hash, the SH projection and the packing to the texture format run on the shared pool,
+    // iblUpdate starts the GPU work once they are done. An environment still decoding is replaced, its result is dropped
+    std::string file = path;
+    IBLBakeSettings settings = iblBakeSettings;
+    GLenum cachedFormat = envMapBackgroundFormat, bakeFormat = envMapBakeSourceFormat;
+    iblBake.decoding = ThreadPool::shared().submit([file, name, settings, cachedFormat, bakeFormat]
     {
-        glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapCube.getTexID(), 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        IBLDecodedEnvironment environment;
+        environment.name = name;
+
+        HDRImageData image;
+        if (!loadHDRImageData(file, true, image))
+            return environment;
+
+        projectIrradianceSH(image.pixels.data(), image.width, image.height, image.components, environment.irradiance);
+
+        // Baked products are cached on disk per environment, a cache hit only needs the background format
+        environment.prefilterPath = getIBLCachePath(getIBLBakeKey(image.hash, settings), "prefilter");
+        environment.cached = std::filesystem::exists(environment.prefilterPath);
+        packHDRImage(image, environment.cached ? cachedFormat : bakeFormat, environment.image);
+
+        return environment;
+    });
+}
+
+
+void iblStart(IBLDecodedEnvironment& environment)
+{
+    // A missing or corrupt file keeps the current environment and whatever it is baking
+    if (!environment.image.isValid())
+    {
+        std::cerr << "IBL - FAILED LOADING, KEEPING THE CURRENT ENVIRONMENT : " << environment.name << std::endl;
+        return;
+    }
 
-        envCubeRender.drawShape();
+    // A bake still in progress is dropped, the new environment reuses its targets
+    iblBake.jobs.clear();
+    if (iblBake.fence)
+    {
+        glDeleteSync(iblBake.fence);
+        iblBake.fence = 0;
     }
 
-    envMapCube.computeTexMipmap();
+    iblBake.prefilterPath = environment.prefilterPath;
+    iblBake.cached = environment.cached;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // The environment on screen stays untouched, everything is built in the "next" textures and swapped in by iblApply.
+    // Its rows go up a strip per upload job, in front of the bake that samples them
+    envMapHDRNext.setTextureHDR(environment.image, environment.irradiance, environment.name);
+
+    GLuint height = environment.image.height;
+    GLuint uploadRows = (GLuint)std::clamp(iblBakeUploadBytes / environment.image.getRowSize(), 1.0, (double)height);
+    for (GLuint row = 0; row < height; row += uploadRows)
+    {
+        GLuint rowCount = std::min(uploadRows, height - row);
+        iblBake.jobs.push_back({ IBL_BAKE_UPLOAD, 0, row, rowCount, (double)environment.image.getRowSize() * rowCount });
+    }
+    iblBake.environment = std::move(environment);
+
+    if (iblBake.cached)
+    {
+        iblBake.jobCount = iblBake.jobs.size();
+        return;
+    }
+
+    iblQueueBake();
+}
 
-    // Diffuse irradiance capture
-    glGenFramebuffers(1, &irradianceFBO);
-    glGenRenderbuffers(1, &irradianceRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, irradianceFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, irradianceRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapIrradiance.getTexWidth(), envMapIrradiance.getTexHeight());
 
-    irradianceIBLShader.use();
+// A cache hit goes live once the environment is uploaded, false when the cached file could not be read
+bool iblApplyCached()
+{
+    iblBake.cached = false;
+
+    if (!loadTextureKTX(iblBake.prefilterPath, envMapPrefilterNext.getTexID(), GL_TEXTURE_CUBE_MAP))
+        return false;
+
+    std::cout << "IBL loaded from cache : " << envMapHDRNext.getTexName() << std::endl;
+    iblApply(false);
+    return true;
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(irradianceIBLShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
-    glActiveTexture(GL_TEXTURE0);
-    envMapCube.useTexture();
 
-    glViewport(0, 0, envMapIrradiance.getTexWidth(), envMapIrradiance.getTexHeight());
-    glBindFramebuffer(GL_FRAMEBUFFER, irradianceFBO);
+void iblQueueBake()
+{
+    if (!envToCubeFBO)
+        glGenFramebuffers(1, &envToCubeFBO);
+    if (!prefilterFBO)
+        glGenFramebuffers(1, &prefilterFBO);
 
-    for (unsigned int i = 0; i < 6; ++i)
+    // A previous cache hit may have loaded the levels as RGB16F, the bake renders and stores RGBA16F
+    for (GLuint mip = 0; mip < iblBakeSettings.prefilterLevels; mip++)
     {
-        glUniformMatrix4fv(glGetUniformLocation(irradianceIBLShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapIrradiance.getTexID(), 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GLuint mipSize = std::max(envMapPrefilterNext.getTexWidth() >> mip, 1u);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, envMapPrefilterNext.getTexID());
+        for (GLuint face = 0; face < 6; face++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGBA16F, mipSize, mipSize, 0, GL_RGBA, GL_FLOAT, NULL);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-        envCubeRender.drawShape();
+    // Latlong to cubemap then its mip chain, and the prefilter per mip, split in strips of rows of about
+    // iblBakeTileWork texel samples. Each strip covers the same rows of all six faces in a single draw or dispatch
+    GLuint cubeSize = envMapCube.getTexWidth();
+    GLuint cubeRows = (GLuint)std::clamp(iblBakeTileWork / (cubeSize * 6.0), 1.0, (double)cubeSize);
+    for (GLuint row = 0; row < cubeSize; row += cubeRows)
+    {
+        GLuint rowCount = std::min(cubeRows, cubeSize - row);
+        iblBake.jobs.push_back({ IBL_BAKE_CUBE, 0, row, rowCount, (double)cubeSize * rowCount * 6.0 });
     }
+    iblBake.jobs.push_back({ IBL_BAKE_CUBE_MIPMAP, 0, 0, 0, (double)cubeSize * cubeSize });
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    for (GLuint mip = 0; mip < iblBakeSettings.prefilterLevels; mip++)
+    {
+        GLuint mipSize = std::max(envMapPrefilterNext.getTexWidth() >> mip, 1u);
+        double rowWork = (double)mipSize * prefilterSampleTables[mip].size() * 6.0;
+        GLuint tileRows = (GLuint)std::clamp(iblBakeTileWork / rowWork, 1.0, (double)mipSize);
 
-    // Prefilter cubemap
-    prefilterIBLShader.use();
+        for (GLuint row = 0; row < mipSize; row += tileRows)
+        {
+            GLuint rowCount = std::min(tileRows, mipSize - row);
+            iblBake.jobs.push_back({ IBL_BAKE_PREFILTER, mip, row, rowCount, rowWork * rowCount });
+        }
+    }
 
-    glUniformMatrix4fv(glGetUniformLocation(prefilterIBLShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
-    envMapCube.useTexture();
+    iblBake.jobCount = iblBake.jobs.size();
+    std::cout << "IBL baking : " << envMapHDRNext.getTexName() << " (" << iblBake.jobCount << " jobs)" << std::endl;
+}
 
-    glGenFramebuffers(1, &prefilterFBO);
-    glGenRenderbuffers(1, &prefilterRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, prefilterFBO);
 
-    unsigned int maxMipLevels = 5;
+// Renders rows [firstRow, firstRow + rowCount) of the six faces of a cubemap mip with the layered shader (one
+// draw, the geometry shader instances route the quad to each face) or the compute variant (one dispatch, z = face)
+void iblRenderCubeRows(const Shader& layeredShader, const Shader& computeShader, GLuint fbo, Texture& target,
+                       GLuint mip, GLuint firstRow, GLuint rowCount)
+{
+    GLuint mipSize = std::max(target.getTexWidth() >> mip, 1u);
 
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+    if (iblComputeMode)
     {
-        unsigned int mipWidth = envMapPrefilter.getTexWidth() * std::pow(0.5, mip);
-        unsigned int mipHeight = envMapPrefilter.getTexHeight() * std::pow(0.5, mip);
+        computeShader.use();
+        glUniform2i(glGetUniformLocation(computeShader.ID, "rowRange"), firstRow, firstRow + rowCount);
+        glBindImageTexture(0, target.getTexID(), mip, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((mipSize + 7) / 8, (rowCount + 7) / 8, 6);
+
+        // the next jobs sample the result (prefilter, mip chain) or the lighting does once it is swapped in
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        return;
+    }
 
-        glBindRenderbuffer(GL_RENDERBUFFER, prefilterRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
+    layeredShader.use();
 
-        glViewport(0, 0, mipWidth, mipHeight);
+    // Every face is seen from the center of the cube, nothing overlaps so no depth attachment is needed
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target.getTexID(), mip);
+    glViewport(0, 0, mipSize, mipSize);
 
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, firstRow, mipSize, rowCount);
+    glClear(GL_COLOR_BUFFER_BIT);
 
-        glUniform1f(glGetUniformLocation(prefilterIBLShader.ID, "roughness"), roughness);
-        glUniform1f(glGetUniformLocation(prefilterIBLShader.ID, "cubeResolutionWidth"), envMapPrefilter.getTexWidth());
-        glUniform1f(glGetUniformLocation(prefilterIBLShader.ID, "cubeResolutionHeight"), envMapPrefilter.getTexHeight());
+    quadRender.drawShape();
 
-        for (unsigned int i = 0; i < 6; ++i)
-        {
-            glUniformMatrix4fv(glGetUniformLocation(prefilterIBLShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapPrefilter.getTexID(), mip);
+    glDisable(GL_SCISSOR_TEST);
+}
 
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            envCubeRender.drawShape();
+void iblRunJob(const IBLBakeJob& job)
+{
+    if (job.pass == IBL_BAKE_UPLOAD)
+    {
+        // timed on the CPU, the copy into the driver is what the frame pays
+        auto start = std::chrono::steady_clock::now();
+        envMapHDRNext.uploadTextureRows(iblBake.environment.image, job.firstRow, job.rowCount);
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        iblBake.nsPerUploadByte = 0.5 * iblBake.nsPerUploadByte + 0.5 * elapsed / job.work;
+
+        if (job.firstRow + job.rowCount == iblBake.environment.image.height)
+            iblBake.environment = IBLDecodedEnvironment();
+    }
+
+    else if (job.pass == IBL_BAKE_CUBE)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        envMapHDRNext.useTexture();
+
+        iblRenderCubeRows(latlongToCubeShader, latlongToCubeComputeShader, envToCubeFBO, envMapCube, 0, job.firstRow, job.rowCount);
+    }
+
+    else if (job.pass == IBL_BAKE_CUBE_MIPMAP)
+    {
+        envMapCube.computeTexMipmap();
+    }
+
+    else if (job.pass == IBL_BAKE_PREFILTER)
+    {
+        const std::vector<PrefilterSample>& samples = prefilterSampleTables[job.mip];
+
+        // Samples of this roughness, precomputed once at startup, the block keeps them until the next mip
+        if (job.mip != iblBake.uploadedMip)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, prefilterSampleUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, samples.size() * sizeof(PrefilterSample), samples.data());
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            iblBake.uploadedMip = job.mip;
         }
+
+        // set per job, the bake may switch between the fragment and compute programs halfway through a mip
+        const Shader& shader = iblComputeMode ? prefilterIBLComputeShader : prefilterIBLShader;
+        shader.use();
+        glUniform1i(glGetUniformLocation(shader.ID, "sampleCount"), (GLint)samples.size());
+
+        glActiveTexture(GL_TEXTURE0);
+        envMapCube.useTexture();
+
+        iblRenderCubeRows(prefilterIBLShader, prefilterIBLComputeShader, prefilterFBO, envMapPrefilterNext, job.mip, job.firstRow, job.rowCount);
+    }
+}
+
+
+void iblUpdate(float budgetMs)
+{
+    if (iblBake.decoding.valid() && iblBake.decoding.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        IBLDecodedEnvironment environment = iblBake.decoding.get();
+        iblStart(environment);
+    }
+
+    // GPU time of the previous batches, read back only once available, refines the cost of a texel sample
+    for (GLuint i = 0; i < iblBakeQueryCount; i++)
+    {
+        if (iblBake.queryWork[i] <= 0.0)
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(iblBake.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(iblBake.queries[i], GL_QUERY_RESULT, &elapsed);
+        iblBake.nsPerWork = 0.5 * iblBake.nsPerWork + 0.5 * (double)elapsed / iblBake.queryWork[i];
+        iblBake.queryWork[i] = 0.0;
+    }
+
+    // Every job has been submitted, the new environment goes live once the GPU is done with them
+    if (iblBake.fence)
+    {
+        GLenum status = glClientWaitSync(iblBake.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return;
+
+        glDeleteSync(iblBake.fence);
+        iblBake.fence = 0;
+        iblApply(true);
+        return;
+    }
+
+    if (iblBake.jobs.empty())
+        return;
+
+    // Jobs are taken in order until their estimated time fills the budget, at least one per frame. The uploads cost
+    // CPU time per byte, the bake GPU time per texel sample
+    GLint query = -1;
+    for (GLuint i = 0; i < iblBakeQueryCount && query < 0; i++)
+        if (iblBake.queryWork[i] <= 0.0)
+            query = i;
+
+    if (!iblBake.queries[0])
+        glGenQueries(iblBakeQueryCount, iblBake.queries);
+    if (query >= 0)
+        glBeginQuery(GL_TIME_ELAPSED, iblBake.queries[query]);
+
+    double budgetNs = budgetMs * 1000000.0;
+    double batchNs = 0.0, batchWork = 0.0;
+    bool uploaded = false;
+    while (!iblBake.jobs.empty())
+    {
+        const IBLBakeJob& job = iblBake.jobs.front();
+        bool upload = job.pass == IBL_BAKE_UPLOAD;
+        double jobNs = job.work * (upload ? iblBake.nsPerUploadByte : iblBake.nsPerWork);
+        if (batchNs > 0.0 && batchNs + jobNs > budgetNs)
+            break;
+
+        iblRunJob(job);
+        batchNs += jobNs;
+        if (upload)
+            uploaded = true;
+        else
+            batchWork += job.work;
+        iblBake.jobs.pop_front();
+    }
+
+    // a query that also timed uploads would skew the cost of a texel sample, its result is left unread
+    if (query >= 0)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        iblBake.queryWork[query] = uploaded ? 0.0 : batchWork;
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+
+    if (iblBake.jobs.empty() && iblBake.cached)
+    {
+        // an unreadable cache file is baked from the uploaded environment instead
+        if (!iblApplyCached())
+            iblQueueBake();
+    }
+    else if (iblBake.jobs.empty())
+        iblBake.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+}
+
+
+void iblFinish()
+{
+    // Runs whatever is left of the bake now, for the first environment there is nothing to keep on screen meanwhile
+    if (iblBake.decoding.valid())
+    {
+        iblBake.decoding.wait();
+        iblUpdate(0.0f);
+    }
 
-    // BRDF LUT
-    glGenFramebuffers(1, &brdfLUTFBO);
-    glGenRenderbuffers(1, &brdfLUTRBO);
+    while (!iblBake.jobs.empty())
+        iblUpdate(std::numeric_limits<float>::max());
+
+    if (iblBake.fence)
+    {
+        glClientWaitSync(iblBake.fence, GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+        iblUpdate(0.0f);
+    }
+}
+
+
+void iblApply(bool save)
+{
+    // The baked environment takes the place of the one on screen, the old HDR is freed and its prefilter becomes the next target
+    envMapHDR.swapTexture(envMapHDRNext);
+    envMapPrefilter.swapTexture(envMapPrefilterNext);
+    envMapHDRNext.releaseTexture();
+
+    // Diffuse irradiance is projected to spherical harmonics when the environment is loaded, only the 27 floats change here
+    lightingBRDFShader.use();
+    glUniform3fv(glGetUniformLocation(lightingBRDFShader.ID, "irradianceSH"), 9, envMapHDR.getTexIrradianceSH().coefficients);
+
+    if (save)
+    {
+        std::cout << "IBL baked : " << envMapHDR.getTexName() << " (" << iblBake.nsPerWork << " ns per texel sample)" << std::endl;
+        saveTextureKTX(iblBake.prefilterPath, envMapPrefilter.getTexID(), GL_TEXTURE_CUBE_MAP, GL_RGB, GL_HALF_FLOAT, iblBakeSettings.prefilterLevels);
+    }
+}
+
+
+void brdfLUTSetup()
+{
+    // The LUT ships with the resources (bakeIBL), the CPU integrator bakes it the first time it is missing
+    std::string lutPath = getBRDFLUTPath(iblBakeSettings);
+
+    if (loadTextureKTX(lutPath, envMapLUT.getTexID(), GL_TEXTURE_2D))
+    {
+        brdfLUTValidate();
+        return;
+    }
+
+    std::cout << "BRDF LUT missing, baking : " << lutPath << std::endl;
+
+    std::vector<float> lut;
+    bakeBRDFLUT(iblBakeSettings.lutSize, lut);
+
+    glBindTexture(GL_TEXTURE_2D, envMapLUT.getTexID());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, iblBakeSettings.lutSize, iblBakeSettings.lutSize, 0, GL_RG, GL_FLOAT, lut.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // a LUT off the reference is not written, the next run bakes it again
+    if (!brdfLUTValidate())
+        return;
+
+    if (!saveBRDFLUTKTX(lutPath, lut, iblBakeSettings.lutSize))
+        std::cerr << "BRDF LUT - FAILED SAVING : " << lutPath << std::endl;
+}
+
+
+// Runs once at startup after the LUT is loaded or baked, and from the environment panel
+bool brdfLUTValidate()
+{
+    // Renders integrateIBL.frag, the GPU reference, and compares it with the LUT in use
+    GLuint lutSize = iblBakeSettings.lutSize;
+    RenderTargetPool& targetPool = RenderTargetPool::instance();
+    GLuint referenceLUT = targetPool.acquireTexture(RenderTargetDesc(lutSize, lutSize, GL_RG16F, GL_RG, GL_FLOAT));
+
+    if (!brdfLUTFBO)
+        glGenFramebuffers(1, &brdfLUTFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, brdfLUTFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, brdfLUTRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapLUT.getTexWidth(), envMapLUT.getTexHeight());
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, envMapLUT.getTexID(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, referenceLUT, 0);
 
-    glViewport(0, 0, envMapLUT.getTexWidth(), envMapLUT.getTexHeight());
+    glViewport(0, 0, lutSize, lutSize);
     integrateIBLShader.use();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT);
 
     quadRender.drawShape();
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
     glViewport(0, 0, viewportWidth, viewportHeight);
+
+    std::vector<float> reference((size_t)lutSize * lutSize * 2), baked((size_t)lutSize * lutSize * 2);
+    glBindTexture(GL_TEXTURE_2D, referenceLUT);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, reference.data());
+    glBindTexture(GL_TEXTURE_2D, envMapLUT.getTexID());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, baked.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    targetPool.releaseTexture(referenceLUT);
+
+    double errorSum = 0.0;
+    brdfLUTMaxError = 0.0f;
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        float error = std::abs(reference[i] - baked[i]);
+        brdfLUTMaxError = std::max(brdfLUTMaxError, error);
+        errorSum += error;
+    }
+    brdfLUTMeanError = (float)(errorSum / reference.size());
+
+    // both are half floats in [0, 1], the GPU transcendentals account for a few ulps
+    bool passed = brdfLUTMaxError < 0.004f;
+    if (passed)
+        std::cout << "BRDF LUT validation : max error " << brdfLUTMaxError << ", mean error " << brdfLUTMeanError << " (passed)" << std::endl;
+    else
+        std::cerr << "BRDF LUT - VALIDATION FAILED : max error " << brdfLUTMaxError << " (limit 0.004), mean error " << brdfLUTMeanError
+                  << ", the LUT in use does not match integrateIBL.frag" << std::endl;
+
+    return passed;
+}
+
+
+void qualityApply(GLfloat saoLevel, GLfloat postprocessLevel)
+{
+    // Interpolates the preset table, fractional levels give the intermediate sample counts
+    auto interpolate = [](GLfloat level, GLint QualitySettings::* setting)
+    {
+        int lower = std::clamp((int)level, 0, 1);
+        GLfloat t = std::clamp(level - lower, 0.0f, 1.0f);
+        return (GLint)std::lround(qualityPresets[lower].*setting + (qualityPresets[lower + 1].*setting - qualityPresets[lower].*setting) * t);
+    };
+
+    saoSamples = interpolate(saoLevel, &QualitySettings::saoSamples);
+    saoTurns = interpolate(saoLevel, &QualitySettings::saoTurns);
+    saoBlurSize = interpolate(saoLevel, &QualitySettings::saoBlurSize);
+    motionBlurMaxSamples = interpolate(postprocessLevel, &QualitySettings::motionBlurMaxSamples);
+}
+
+
+void qualityGovernorUpdate()
+{
+    // Each level follows the time of its pass: down in proportion to the overrun, up slowly once well under the
+    // budget, the gap between both keeps the sample counts from flickering between two values
+    if (quality.preset != QUALITY_ADAPTIVE)
+        return;
+
+    GLint previous[4] = { saoSamples, saoTurns, saoBlurSize, motionBlurMaxSamples };
+
+    if (saoMode && deltaSAOTime > 0.0f)
+    {
+        GLfloat saoTime = deltaSAOTime / (renderScale * renderScale);      // SAO covers renderScale^2 of the pixels
+        GLfloat overrun = (saoTime - quality.saoBudget) / quality.saoBudget;
+        if (overrun > 0.0f)
+            quality.saoLevel -= std::min(overrun, 1.0f) * 0.1f;
+        else if (overrun < -0.25f)
+            quality.saoLevel += 0.01f;
+    }
+
+    if (motionBlurMode && deltaPostprocessTime > 0.0f)
+    {
+        GLfloat overrun = (deltaPostprocessTime - quality.postprocessBudget) / quality.postprocessBudget;
+        if (overrun > 0.0f)
+            quality.postprocessLevel -= std::min(overrun, 1.0f) * 0.1f;
+        else if (overrun < -0.25f)
+            quality.postprocessLevel += 0.01f;
+    }
+
+    quality.saoLevel = std::clamp(quality.saoLevel, 0.0f, 2.0f);
+    quality.postprocessLevel = std::clamp(quality.postprocessLevel, 0.0f, 2.0f);
+    qualityApply(quality.saoLevel, quality.postprocessLevel);
+
+    if (previous[0] != saoSamples || previous[1] != saoTurns || previous[2] != saoBlurSize || previous[3] != motionBlurMaxSamples)
+        std::cout << "Quality : SAO " << saoSamples << " samples, " << saoTurns << " turns, blur radius " << saoBlurSize
+                  << " - motion blur " << motionBlurMaxSamples << " samples" << std::endl;
+}
+
+
+void dynamicResolutionUpdate()
+{
+    // The geometry, SAO and lighting passes cost about the pixel count, the square of the scale. The post-processing
+    // and forward passes run at the viewport size, they take their share of the target first
+    if (!dynamicResolutionMode)
+    {
+        renderScale = 1.0f;
+        return;
+    }
+
+    // the target format comparison needs two frames at the same resolution
+    if (formatDiffStep != 0)
+        return;
+
+    GLfloat scaledTime = deltaGeometryTime + deltaSAOTime + deltaLightingTime;
+    GLfloat fixedTime = deltaPostprocessTime + deltaForwardTime;
+    if (scaledTime <= 0.0f)
+        return;
+
+    GLfloat budget = std::max(dynamicResolutionTarget - fixedTime, dynamicResolutionTarget * 0.25f);
+    GLfloat targetScale = renderScale * std::sqrt(budget / scaledTime);
+
+    // down quickly when over budget, up slowly so one cheap frame does not bounce the scale back
+    GLfloat rate = targetScale < renderScale ? 0.5f : 0.05f;
+    renderScale = std::clamp(renderScale + (targetScale - renderScale) * rate, std::min(renderScaleMin, 1.0f), 1.0f);
 }
 
+
+void formatDiffStart()
+{
+    // The next frame renders with full float targets and settles the view: the camera, the SAO rotation, its history
+    // and the sample counts hold until the comparison ends, so the velocities of the two compared frames are zero
+    formatDiffSaved[0] = postprocessFormat;
+    formatDiffSaved[1] = screenFormat;
+    postprocessFormat = screenFormat = GL_RGBA32F;
+    postprocessSetup();
+    screenSetup();
+    formatDiffStep = 1;
+}
+
+
+void formatDiffUpdate()
+{
+    // Image diff of the configured intermediate formats against GL_RGBA32F, over two frames of the same view after a
+    // settling one: the reference frame is read back, then the frame rendered with the configured formats is compared to it
+    if (formatDiffStep == 0)
+        return;
+
+    if (formatDiffStep == 1)
+    {
+        formatDiffStep = 2;
+        return;
+    }
+
+    size_t pixelCount = (size_t)viewportWidth * viewportHeight;
+    std::vector<float> frame(pixelCount * 4);
+    glBindTexture(GL_TEXTURE_2D, screenBuffer);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, frame.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (formatDiffStep == 2)
+    {
+        formatDiffReference = std::move(frame);
+        postprocessFormat = formatDiffSaved[0];
+        screenFormat = formatDiffSaved[1];
+        postprocessSetup();
+        screenSetup();
+        formatDiffStep = 3;
+        return;
+    }
+
+    formatDiffStep = 0;
+
+    if (formatDiffReference.size() != frame.size())
+    {
+        std::cout << "Target format comparison : viewport resized, run it again" << std::endl;
+        formatDiffReference = std::vector<float>();
+        return;
+    }
+
+    // on the displayed values, the post-processing output is tonemapped and gamma corrected
+    double squaredErrorSum = 0.0;
+    formatDiffMaxError = 0.0f;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float reference = std::clamp(formatDiffReference[i * 4 + c], 0.0f, 1.0f);
+            float error = std::abs(std::clamp(frame[i * 4 + c], 0.0f, 1.0f) - reference);
+            formatDiffMaxError = std::max(formatDiffMaxError, error);
+            squaredErrorSum += (double)error * error;
+        }
+    }
+    formatDiffReference = std::vector<float>();
+
+    double meanSquaredError = squaredErrorSum / (pixelCount * 3);
+    formatDiffPSNR = meanSquaredError > 0.0 ? (float)(10.0 * std::log10(1.0 / meanSquaredError)) : 99.0f;
+
+    // above 40 dB the differences are below what an 8 bit display shows on average
+    std::cout << "Target format comparison : PSNR " << formatDiffPSNR << " dB, max error " << formatDiffMaxError
+              << (formatDiffPSNR >= 40.0f ? " (passed)" : " (FAILED)") << std::endl;
+}
+
+
 bool putEntityInSceneHierarchyPanel(Entity& entity, Entity*& ptrToSelectedEntity) 
 {
     bool deletedEntity = false;                                             // Flag to skip rendering if entity deleted
@@ -1897,13 +3096,16 @@ void processInput(GLFWwindow* window)
     /*if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);*/
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && mouseDragEnabled)
+    // the camera holds still while the target formats are compared
+    bool cameraFree = mouseDragEnabled && formatDiffStep == 0;
+
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && cameraFree)
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && mouseDragEnabled)
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && cameraFree)
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && mouseDragEnabled)
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && cameraFree)
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && mouseDragEnabled)
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && cameraFree)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
     //Gizmos
@@ -1971,7 +3173,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     lastX = xpos;
     lastY = ypos;
 
-    if (mouseDragEnabled)
+    if (mouseDragEnabled && formatDiffStep == 0)
     {
         camera.ProcessMouseMovement(xoffset, yoffset);
     }
@@ -1981,7 +3183,8 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(yoffset, mouseDragEnabled);
+    if (formatDiffStep == 0)
+        camera.ProcessMouseScroll(yoffset, mouseDragEnabled);
 }
 
 // glfw: whenever the mouse button is pressed, this callback is called
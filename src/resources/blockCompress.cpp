@@ -0,0 +1,505 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <cctype>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define BLOCKCOMPRESS_SSE2
+#endif
+
+#include <glad/glad.h>
+
+#include <components/threadpool.h>
+
+#include "image.h"
+#include "contentHash.h"
+#include "blockCompress.h"
+
+
+// Real-time block encoders: bounding box endpoints (inset and oriented along the color covariance),
+// then the best palette entry for each texel. Fast enough to cook textures at import time.
+
+static void getBlockBounds(const unsigned char* rgba, unsigned char* minColor, unsigned char* maxColor)
+{
+#ifdef BLOCKCOMPRESS_SSE2
+    __m128i row0 = _mm_loadu_si128((const __m128i*)(rgba + 0));
+    __m128i row1 = _mm_loadu_si128((const __m128i*)(rgba + 16));
+    __m128i row2 = _mm_loadu_si128((const __m128i*)(rgba + 32));
+    __m128i row3 = _mm_loadu_si128((const __m128i*)(rgba + 48));
+
+    __m128i lo = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+    __m128i hi = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+    lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+    lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    uint32_t packedMin = (uint32_t)_mm_cvtsi128_si32(lo);
+    uint32_t packedMax = (uint32_t)_mm_cvtsi128_si32(hi);
+    std::memcpy(minColor, &packedMin, 4);
+    std::memcpy(maxColor, &packedMax, 4);
+#else
+    for (int c = 0; c < 4; c++)
+    {
+        minColor[c] = 255;
+        maxColor[c] = 0;
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            minColor[c] = std::min(minColor[c], rgba[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], rgba[i * 4 + c]);
+        }
+    }
+#endif
+}
+
+
+// Shrinks the box by 1/16 of its size (the extremes are rarely worth an exact palette entry), then flips
+// the channels that go against the main one so the box diagonal follows the distribution of the texels
+static void getBlockEndpoints(const unsigned char* rgba, int channels, int* start, int* end)
+{
+    unsigned char minColor[4], maxColor[4];
+    getBlockBounds(rgba, minColor, maxColor);
+
+    int mean[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+            mean[c] += rgba[i * 4 + c];
+
+    int reference = 0;
+    for (int c = 0; c < channels; c++)
+    {
+        mean[c] = (mean[c] + 8) / 16;
+        if (maxColor[c] - minColor[c] > maxColor[reference] - minColor[reference])
+            reference = c;
+    }
+
+    for (int c = 0; c < channels; c++)
+    {
+        int inset = (maxColor[c] - minColor[c]) >> 4;
+        start[c] = minColor[c] + inset;
+        end[c] = maxColor[c] - inset;
+
+        if (c == reference)
+            continue;
+
+        int covariance = 0;
+        for (int i = 0; i < 16; i++)
+            covariance += (rgba[i * 4 + reference] - mean[reference]) * (rgba[i * 4 + c] - mean[c]);
+
+        if (covariance < 0)
+            std::swap(start[c], end[c]);
+    }
+}
+
+
+static uint16_t packRGB565(const int* color)
+{
+    return (uint16_t)((((color[0] * 31 + 127) / 255) << 11) | (((color[1] * 63 + 127) / 255) << 5) | ((color[2] * 31 + 127) / 255));
+}
+
+
+static void unpackRGB565(uint16_t packed, int* color)
+{
+    int r = packed >> 11;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+
+void compressBlockBC1(const unsigned char* rgba, unsigned char* block)
+{
+    int start[4], end[4];
+    getBlockEndpoints(rgba, 3, start, end);
+
+    uint16_t color0 = packRGB565(end);
+    uint16_t color1 = packRGB565(start);
+
+    int palette[4][3];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int bestIndex = 0;
+            int bestError = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = rgba[i * 4 + 0] - palette[p][0];
+                int dg = rgba[i * 4 + 1] - palette[p][1];
+                int db = rgba[i * 4 + 2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indices |= (uint32_t)bestIndex << (i * 2);
+        }
+
+        // color0 > color1 selects the 4 colors mode, swapping the endpoints mirrors the palette (0<->1, 2<->3)
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+            indices ^= 0x55555555;
+        }
+    }
+
+    block[0] = color0 & 0xFF;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF;
+    block[3] = color1 >> 8;
+    std::memcpy(block + 4, &indices, 4);
+}
+
+
+void compressBlockBC4(const unsigned char* rgba, unsigned char* block, GLuint channel)
+{
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        minValue = std::min(minValue, (int)rgba[i * 4 + channel]);
+        maxValue = std::max(maxValue, (int)rgba[i * 4 + channel]);
+    }
+
+    // red0 > red1 selects the 8 values mode: red0, red1 and 6 values interpolated in between
+    block[0] = (unsigned char)maxValue;
+    block[1] = (unsigned char)minValue;
+
+    uint64_t indices = 0;
+    int range = maxValue - minValue;
+    if (range > 0)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int step = ((maxValue - rgba[i * 4 + channel]) * 14 + range) / (2 * range);
+            uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+            indices |= index << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+
+void compressBlockBC3(const unsigned char* rgba, unsigned char* block)
+{
+    compressBlockBC4(rgba, block, 3);
+    compressBlockBC1(rgba, block + 8);
+}
+
+
+void compressBlockBC5(const unsigned char* rgba, unsigned char* block)
+{
+    compressBlockBC4(rgba, block, 0);
+    compressBlockBC4(rgba, block + 8, 1);
+}
+
+
+static void writeBits(unsigned char* block, unsigned int& position, uint32_t value, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, position++)
+        block[position >> 3] |= ((value >> i) & 1) << (position & 7);
+}
+
+
+// BC7 mode 6: a single subset, RGBA endpoints on 7 bits plus a shared low bit each, 16 interpolated colors
+void compressBlockBC7(const unsigned char* rgba, unsigned char* block)
+{
+    static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    int start[4], end[4];
+    getBlockEndpoints(rgba, 4, start, end);
+
+    // pick the low bit that brings the quantized endpoint the closest to the wanted one
+    int quantized[2][4];
+    int pbits[2];
+    int* endpoints[2] = { start, end };
+    for (int e = 0; e < 2; e++)
+    {
+        int bestError = 1 << 30;
+        for (int p = 0; p < 2; p++)
+        {
+            int error = 0;
+            int candidate[4];
+            for (int c = 0; c < 4; c++)
+            {
+                candidate[c] = std::min(std::max((endpoints[e][c] - p + 1) >> 1, 0), 127);
+                int difference = ((candidate[c] << 1) | p) - endpoints[e][c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbits[e] = p;
+                std::memcpy(quantized[e], candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int e0 = (quantized[0][c] << 1) | pbits[0];
+            int e1 = (quantized[1][c] << 1) | pbits[1];
+            palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+        }
+    }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int bestError = 1 << 30;
+        for (int p = 0; p < 16; p++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int difference = rgba[i * 4 + c] - palette[p][c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+    }
+
+    // the high bit of the first index is implicit (0), mirror the endpoints when it would be set
+    if (indices[0] >= 8)
+    {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pbits[0], pbits[1]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    std::memset(block, 0, 16);
+    unsigned int position = 0;
+    writeBits(block, position, 1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        writeBits(block, position, quantized[0][c], 7);
+        writeBits(block, position, quantized[1][c], 7);
+    }
+    writeBits(block, position, pbits[0], 1);
+    writeBits(block, position, pbits[1], 1);
+    writeBits(block, position, indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        writeBits(block, position, indices[i], 4);
+}
+
+
+BlockFormat chooseBlockFormat(TextureUsage usage, GLuint components, bool highQuality)
+{
+    if (usage == TextureUsage::Normal)
+        return BlockFormat::BC5;
+    if (usage == TextureUsage::Mask)
+        return BlockFormat::BC4;
+    if (highQuality)
+        return BlockFormat::BC7;
+
+    // 2 channel color images are grey + alpha
+    bool hasAlpha = components == 4 || components == 2;
+    return hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+
+// Words of the file name, split on separators, digits and camel case: "Car_metallicRoughness2.png" -> car, metallic, roughness
+static std::vector<std::string> getNameWords(const std::string& path)
+{
+    size_t start = path.find_last_of("/\\");
+    std::string name = path.substr(start == std::string::npos ? 0 : start + 1);
+    name = name.substr(0, name.rfind('.'));
+
+    std::vector<std::string> words;
+    std::string word;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        unsigned char c = (unsigned char)name[i];
+        bool split = !std::isalpha(c) || (std::isupper(c) && i > 0 && std::islower((unsigned char)name[i - 1]));
+
+        if (split && !word.empty())
+        {
+            words.push_back(word);
+            word.clear();
+        }
+        if (std::isalpha(c))
+            word += (char)std::tolower(c);
+    }
+    if (!word.empty())
+        words.push_back(word);
+
+    return words;
+}
+
+
+TextureUsage getUsageFromPath(const std::string& path)
+{
+    // long names match as word prefixes (roughnessmap), short ones only as whole words (ao, not chaos)
+    static const std::vector<std::string> normalPrefixes = { "normal" };
+    static const std::vector<std::string> normalWords = { "nrm", "nor", "nml", "norm" };
+    static const std::vector<std::string> maskPrefixes = { "rough", "metal", "occlusion", "ambient", "gloss", "specular", "height", "displace", "bump" };
+    static const std::vector<std::string> maskWords = { "ao", "spec", "disp", "orm", "arm", "mask" };
+
+    auto matches = [](const std::string& word, const std::vector<std::string>& prefixes, const std::vector<std::string>& wholeWords)
+    {
+        for (auto& prefix : prefixes)
+            if (word.compare(0, prefix.size(), prefix) == 0)
+                return true;
+        return std::find(wholeWords.begin(), wholeWords.end(), word) != wholeWords.end();
+    };
+
+    std::vector<std::string> words = getNameWords(path);
+
+    for (auto& word : words)
+        if (matches(word, normalPrefixes, normalWords))
+            return TextureUsage::Normal;
+
+    for (auto& word : words)
+        if (matches(word, maskPrefixes, maskWords))
+            return TextureUsage::Mask;
+
+    return TextureUsage::Color;
+}
+
+
+GLenum getBlockFormatGL(BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+
+    return 0;
+}
+
+
+GLuint getBlockFormatSize(BlockFormat format)
+{
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+
+const char* getBlockFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return "bc1";
+        case BlockFormat::BC3: return "bc3";
+        case BlockFormat::BC4: return "bc4";
+        case BlockFormat::BC5: return "bc5";
+        case BlockFormat::BC7: return "bc7";
+    }
+
+    return "";
+}
+
+
+// gathers a 4x4 block as RGBA8, texels past the edge repeat the last row / column
+static void fetchBlock(const ImageData& image, GLuint level, GLuint blockX, GLuint blockY, unsigned char* rgba)
+{
+    const unsigned char* pixels = image.getLevelPixels(level);
+    GLuint width = image.getLevelWidth(level);
+    GLuint height = image.getLevelHeight(level);
+    GLuint components = image.components;
+
+    for (GLuint y = 0; y < 4; y++)
+    {
+        GLuint sourceY = std::min(blockY * 4 + y, height - 1);
+        for (GLuint x = 0; x < 4; x++)
+        {
+            GLuint sourceX = std::min(blockX * 4 + x, width - 1);
+            const unsigned char* texel = pixels + ((size_t)sourceY * width + sourceX) * components;
+            unsigned char* target = rgba + (y * 4 + x) * 4;
+
+            target[0] = texel[0];
+            target[1] = components >= 2 ? texel[1] : texel[0];
+            target[2] = components >= 3 ? texel[2] : (components == 2 ? 0 : texel[0]);
+            target[3] = components == 4 ? texel[3] : 255;
+        }
+    }
+}
+
+
+bool compressImage(const ImageData& source, BlockFormat format, ImageData& compressed)
+{
+    if (!source.isValid() || source.isCompressed())
+        return false;
+
+    compressed.path = source.path;
+    compressed.width = source.width;
+    compressed.height = source.height;
+    compressed.components = source.components;
+    compressed.format = source.format;
+    compressed.internalFormat = getBlockFormatGL(format);
+    compressed.blockSize = getBlockFormatSize(format);
+
+    GLuint levels = source.getLevelCount();
+    compressed.levelOffsets.resize(levels);
+    size_t totalSize = 0;
+    for (GLuint level = 0; level < levels; level++)
+    {
+        compressed.levelOffsets[level] = totalSize;
+        totalSize += compressed.getLevelSize(level);
+    }
+    compressed.pixels.assign(totalSize, 0);
+
+    // one job per row of blocks, over all the levels
+    std::vector<std::pair<GLuint, GLuint>> rows;
+    for (GLuint level = 0; level < levels; level++)
+        for (GLuint row = 0; row < compressed.getLevelRowCount(level); row++)
+            rows.push_back(std::make_pair(level, row));
+
+    ThreadPool::shared().parallelFor((unsigned int)rows.size(), [&](unsigned int i)
+    {
+        GLuint level = rows[i].first;
+        GLuint row = rows[i].second;
+        GLuint blocksPerRow = (compressed.getLevelWidth(level) + 3) / 4;
+        unsigned char* output = compressed.pixels.data() + compressed.levelOffsets[level] + row * compressed.getLevelRowSize(level);
+        unsigned char rgba[64];
+
+        for (GLuint blockX = 0; blockX < blocksPerRow; blockX++, output += compressed.blockSize)
+        {
+            fetchBlock(source, level, blockX, row, rgba);
+
+            switch (format)
+            {
+                case BlockFormat::BC1: compressBlockBC1(rgba, output); break;
+                case BlockFormat::BC3: compressBlockBC3(rgba, output); break;
+                case BlockFormat::BC4: compressBlockBC4(rgba, output); break;
+                case BlockFormat::BC5: compressBlockBC5(rgba, output); break;
+                case BlockFormat::BC7: compressBlockBC7(rgba, output); break;
+            }
+        }
+    });
+
+    compressed.hash = hashBytes(compressed.pixels.data(), compressed.pixels.size(), hashMix(hashMix(compressed.width, compressed.height), compressed.internalFormat));
+
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef BLOCKCOMPRESS_H
+#define BLOCKCOMPRESS_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+#include "image.h"
+
+// S3TC enums come from GL_EXT_texture_compression_s3tc, not every glad build exports them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+
+enum class BlockFormat
+{
+    BC1,
+    BC3,
+    BC4,
+    BC5,
+    BC7
+};
+
+
+BlockFormat chooseBlockFormat(TextureUsage usage, GLuint components, bool highQuality = false);
+TextureUsage getUsageFromPath(const std::string& path);        // guesses the usage from the file name, the cookTextures default
+GLenum getBlockFormatGL(BlockFormat format);
+GLuint getBlockFormatSize(BlockFormat format);                 // bytes per 4x4 block
+const char* getBlockFormatName(BlockFormat format);
+
+// Encode one 4x4 block of RGBA8 pixels (64 bytes, row major)
+void compressBlockBC1(const unsigned char* rgba, unsigned char* block);
+void compressBlockBC3(const unsigned char* rgba, unsigned char* block);
+void compressBlockBC4(const unsigned char* rgba, unsigned char* block, GLuint channel = 0);
+void compressBlockBC5(const unsigned char* rgba, unsigned char* block);
+void compressBlockBC7(const unsigned char* rgba, unsigned char* block);
+
+// Compresses every level of an uncompressed image, block rows are spread over the shared thread pool
+bool compressImage(const ImageData& source, BlockFormat format, ImageData& compressed);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+
+// 64 bits non cryptographic hash, used to key the resource caches on the content of a file or buffer
+// Processes 8 bytes at a time so that hashing a decoded 4k texture stays cheap on the worker threads
+inline uint64_t hashMix(uint64_t hash, uint64_t value)
+{
+    hash ^= value * 0x9E3779B97F4A7C15ull;
+    hash = (hash << 31) | (hash >> 33);
+    return hash * 0xBF58476D1CE4E5B9ull;
+}
+
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xCBF29CE484222325ull)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = hashMix(seed, size);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = hashMix(hash, word);
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + i, size - i);
+    hash = hashMix(hash, tail);
+
+    // final avalanche
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+
+inline uint64_t hashString(const std::string& str, uint64_t seed = 0xCBF29CE484222325ull)
+{
+    return hashBytes(str.data(), str.size(), seed);
+}
+
+
+
+// hash of a whole file, 0 if it cannot be read
+inline uint64_t hashFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 0;
+
+    std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    return hashBytes(content.data(), content.size());
+}
+
+#endif
@@ -0,0 +1,305 @@
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define HDRPACK_SSE2
+#endif
+
+#include <glad/glad.h>
+
+#include <components/threadpool.h>
+
+#include "hdrPack.h"
+
+
+// texels per job of the bulk conversions
+static const size_t packChunkSize = 16384;
+
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u)                       // inf / nan
+        return (uint16_t)(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    if (magnitude >= 0x477FF000u)                       // rounds above the largest half
+        return (uint16_t)(sign | 0x7C00u);
+    if (magnitude < 0x38800000u)                        // denormal half, round to nearest even
+    {
+        if (magnitude < 0x33000000u)
+            return (uint16_t)sign;
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = ((magnitude - 0x38000000u) >> 13);
+    uint32_t remainder = magnitude & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        half++;
+
+    return (uint16_t)(sign | half);
+}
+
+
+// EXT_texture_shared_exponent: 9 bit mantissas, 5 bit exponent biased by 15, the exponent is the one of the largest
+// channel, bumped when its mantissa rounds up to 512. floor(log2(x)) is read from the float exponent, 2^n scales are exact
+uint32_t floatToRGB9E5(float red, float green, float blue)
+{
+    const float maxValue = 65408.0f;        // (511 / 512) * 2^16
+    float rgb[3] = { red, green, blue };
+
+    for (auto& channel : rgb)
+        channel = channel > 0.0f ? std::min(channel, maxValue) : 0.0f;       // NaN fails the test too
+
+    float maxChannel = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+    uint32_t bits;
+    std::memcpy(&bits, &maxChannel, sizeof(bits));
+
+    int exponent = std::max((int)(bits >> 23), 127 - 16) - (127 - 16);      // floor(log2(max)) + 1 + 15, at least 0
+
+    auto power = [](int shift) { uint32_t scaleBits = (uint32_t)(127 + shift) << 23; float scale; std::memcpy(&scale, &scaleBits, sizeof(scale)); return scale; };
+
+    float scale = power(24 - exponent);
+    if ((uint32_t)(maxChannel * scale + 0.5f) == 512)
+    {
+        exponent++;
+        scale *= 0.5f;
+    }
+
+    uint32_t packed = (uint32_t)exponent << 27;
+    for (int c = 0; c < 3; c++)
+        packed |= (uint32_t)(rgb[c] * scale + 0.5f) << (9 * c);
+
+    return packed;
+}
+
+
+#ifdef HDRPACK_SSE2
+// floatToHalf on 4 lanes (branchless, F. Giesen's rounding trick), the halves come back sign extended to 32 bits
+// so that _mm_packs_epi32 narrows them without saturating
+static inline __m128i halfFromFloat4(__m128 value)
+{
+    const __m128i infinity32 = _mm_set1_epi32(0x7F800000);
+    const __m128i halfOverflow = _mm_set1_epi32(0x47800000);       // rounds to infinity from here on
+    const __m128i halfMinNormal = _mm_set1_epi32(0x38800000);
+    const __m128i denormalMagic = _mm_set1_epi32(0x3F000000);      // adding 0.5 aligns the denormal mantissa, rounding it
+    const __m128i normalBias = _mm_set1_epi32(0x0FFF - 0x38000000);  // exponent rebias and half of the dropped bits
+
+    __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u)));
+    __m128i magnitude = _mm_castps_si128(_mm_xor_ps(value, sign));
+
+    __m128i isNaN = _mm_cmpgt_epi32(magnitude, infinity32);
+    __m128i isRegular = _mm_cmpgt_epi32(halfOverflow, magnitude);
+    __m128i isDenormal = _mm_cmpgt_epi32(halfMinNormal, magnitude);
+    __m128i special = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+
+    __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(magnitude), _mm_castsi128_ps(denormalMagic))), denormalMagic);
+
+    __m128i odd = _mm_srai_epi32(_mm_slli_epi32(magnitude, 31 - 13), 31);        // -1 when the half mantissa is odd
+    __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(magnitude, normalBias), odd), 13);
+
+    __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+    __m128i half = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+
+    return _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+
+static inline __m128 power4(__m128i shift)
+{
+    return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(shift, _mm_set1_epi32(127)), 23));
+}
+
+
+// floatToRGB9E5 on 4 texels, channels in separate registers
+static inline __m128i rgb9e5FromFloat4(__m128 red, __m128 green, __m128 blue)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxValue = _mm_set1_ps(65408.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    // _mm_max_ps returns its second operand when the first is NaN
+    red = _mm_min_ps(_mm_max_ps(red, zero), maxValue);
+    green = _mm_min_ps(_mm_max_ps(green, zero), maxValue);
+    blue = _mm_min_ps(_mm_max_ps(blue, zero), maxValue);
+    __m128 maxChannel = _mm_max_ps(red, _mm_max_ps(green, blue));
+
+    __m128i biased = _mm_srli_epi32(_mm_castps_si128(maxChannel), 23);
+    __m128i minBiased = _mm_set1_epi32(127 - 16);
+    __m128i tooSmall = _mm_cmplt_epi32(biased, minBiased);
+    __m128i exponent = _mm_sub_epi32(_mm_or_si128(_mm_and_si128(tooSmall, minBiased), _mm_andnot_si128(tooSmall, biased)), minBiased);
+
+    __m128 scale = power4(_mm_sub_epi32(_mm_set1_epi32(24), exponent));
+    __m128i maxMantissa = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxChannel, scale), half));
+    __m128i roundsUp = _mm_cmpeq_epi32(maxMantissa, _mm_set1_epi32(512));
+    exponent = _mm_sub_epi32(exponent, roundsUp);
+    scale = _mm_mul_ps(scale, _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(roundsUp), half), _mm_andnot_ps(_mm_castsi128_ps(roundsUp), _mm_set1_ps(1.0f))));
+
+    __m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(red, scale), half));
+    __m128i g = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(green, scale), half));
+    __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(blue, scale), half));
+
+    return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 9)), _mm_or_si128(_mm_slli_epi32(b, 18), _mm_slli_epi32(exponent, 27)));
+}
+#endif
+
+
+static void packHalfRange(const float* pixels, GLuint components, size_t first, size_t last, uint16_t* destination)
+{
+    size_t texel = first;
+
+#ifdef HDRPACK_SSE2
+    // two texels per store, one per register
+    for (; texel + 2 <= last; texel += 2)
+    {
+        const float* source = pixels + texel * components;
+        __m128 first4, second4;
+
+        if (components == 4)
+        {
+            first4 = _mm_loadu_ps(source);
+            second4 = _mm_loadu_ps(source + 4);
+        }
+        else
+        {
+            first4 = _mm_setr_ps(source[0], source[1], source[2], 1.0f);
+            second4 = _mm_setr_ps(source[3], source[4], source[5], 1.0f);
+        }
+
+        _mm_storeu_si128((__m128i*)(destination + texel * 4), _mm_packs_epi32(halfFromFloat4(first4), halfFromFloat4(second4)));
+    }
+#endif
+
+    for (; texel < last; texel++)
+    {
+        const float* source = pixels + texel * components;
+        for (GLuint c = 0; c < 3; c++)
+            destination[texel * 4 + c] = floatToHalf(source[c]);
+        destination[texel * 4 + 3] = components == 4 ? floatToHalf(source[3]) : 0x3C00;
+    }
+}
+
+
+static void packRGB9E5Range(const float* pixels, GLuint components, size_t first, size_t last, uint32_t* destination)
+{
+    size_t texel = first;
+
+#ifdef HDRPACK_SSE2
+    for (; texel + 4 <= last; texel += 4)
+    {
+        const float* source = pixels + texel * components;
+        __m128 red, green, blue;
+
+        if (components == 4)
+        {
+            __m128 texel0 = _mm_loadu_ps(source);
+            __m128 texel1 = _mm_loadu_ps(source + 4);
+            __m128 texel2 = _mm_loadu_ps(source + 8);
+            __m128 texel3 = _mm_loadu_ps(source + 12);
+            _MM_TRANSPOSE4_PS(texel0, texel1, texel2, texel3);
+            red = texel0;
+            green = texel1;
+            blue = texel2;
+        }
+        else
+        {
+            red = _mm_setr_ps(source[0], source[3], source[6], source[9]);
+            green = _mm_setr_ps(source[1], source[4], source[7], source[10]);
+            blue = _mm_setr_ps(source[2], source[5], source[8], source[11]);
+        }
+
+        _mm_storeu_si128((__m128i*)(destination + texel), rgb9e5FromFloat4(red, green, blue));
+    }
+#endif
+
+    for (; texel < last; texel++)
+    {
+        const float* source = pixels + texel * components;
+        destination[texel] = floatToRGB9E5(source[0], source[1], source[2]);
+    }
+}
+
+
+void packHalfRGBA(const float* pixels, GLuint components, size_t texelCount, uint16_t* destination)
+{
+    size_t chunkCount = (texelCount + packChunkSize - 1) / packChunkSize;
+
+    ThreadPool::shared().parallelFor((unsigned int)chunkCount, [&](unsigned int chunk)
+    {
+        size_t first = chunk * packChunkSize;
+        packHalfRange(pixels, components, first, std::min(first + packChunkSize, texelCount), destination);
+    });
+}
+
+
+void packRGB9E5(const float* pixels, GLuint components, size_t texelCount, uint32_t* destination)
+{
+    size_t chunkCount = (texelCount + packChunkSize - 1) / packChunkSize;
+
+    ThreadPool::shared().parallelFor((unsigned int)chunkCount, [&](unsigned int chunk)
+    {
+        size_t first = chunk * packChunkSize;
+        packRGB9E5Range(pixels, components, first, std::min(first + packChunkSize, texelCount), destination);
+    });
+}
+
+
+bool packHDRImage(const HDRImageData& image, GLenum internalFormat, HDRPackedImageData& packed)
+{
+    packed = HDRPackedImageData();
+    if (!image.isValid())
+        return false;
+
+    packed.width = image.width;
+    packed.height = image.height;
+    packed.components = image.components;
+    packed.hash = image.hash;
+
+    size_t texelCount = (size_t)image.width * image.height;
+
+    // Half floats keep a 10 bit mantissa per channel in 8 bytes, RGB9_E5 shares one exponent between the channels in 4,
+    // both converted on the CPU so the driver never holds the 32 bits floats
+    if (internalFormat == GL_RGBA16F)
+    {
+        packed.internalFormat = GL_RGBA16F;
+        packed.format = GL_RGBA;
+        packed.type = GL_HALF_FLOAT;
+        packed.texelSize = 4 * sizeof(uint16_t);
+        packed.pixels.resize(texelCount * packed.texelSize);
+        packHalfRGBA(image.pixels.data(), image.components, texelCount, (uint16_t*)packed.pixels.data());
+    }
+    else if (internalFormat == GL_RGB9_E5)
+    {
+        packed.internalFormat = GL_RGB9_E5;
+        packed.format = GL_RGB;
+        packed.type = GL_UNSIGNED_INT_5_9_9_9_REV;
+        packed.texelSize = sizeof(uint32_t);
+        packed.pixels.resize(texelCount * packed.texelSize);
+        packRGB9E5(image.pixels.data(), image.components, texelCount, (uint32_t*)packed.pixels.data());
+    }
+    else
+    {
+        // Full 32bits floating point, as decoded
+        packed.internalFormat = image.components == 4 ? GL_RGBA32F : GL_RGB32F;
+        packed.format = image.components == 4 ? GL_RGBA : GL_RGB;
+        packed.type = GL_FLOAT;
+        packed.texelSize = image.components * sizeof(float);
+        packed.pixels.resize(texelCount * packed.texelSize);
+        std::memcpy(packed.pixels.data(), image.pixels.data(), packed.pixels.size());
+    }
+
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef HDRPACK_H
+#define HDRPACK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "image.h"
+
+
+// Float pixels to the compact HDR formats GL samples natively, rounded to nearest even like the driver would.
+// The bulk versions convert 4 channels / texels at a time with SSE2 and spread the work over the shared thread pool.
+
+uint16_t floatToHalf(float value);
+uint32_t floatToRGB9E5(float red, float green, float blue);     // GL_RGB9_E5, GL_UNSIGNED_INT_5_9_9_9_REV layout
+
+// rgb or rgba floats to GL_RGBA16F texels (4 half floats, alpha 1 for rgb sources)
+void packHalfRGBA(const float* pixels, GLuint components, size_t texelCount, uint16_t* destination);
+
+// rgb or rgba floats to GL_RGB9_E5 texels (alpha dropped), negative and NaN channels become 0, the rest clamps at 65408
+void packRGB9E5(const float* pixels, GLuint components, size_t texelCount, uint32_t* destination);
+
+
+// HDR image converted to the storage of its texture, so the render thread only copies rows to the GPU
+struct HDRPackedImageData
+{
+    GLuint width = 0;
+    GLuint height = 0;
+    GLuint components = 0;                  // of the decoded image
+    GLenum internalFormat = 0;
+    GLenum format = 0;
+    GLenum type = 0;
+    GLuint texelSize = 0;                   // bytes, rows are 4 bytes aligned for every format
+    uint64_t hash = 0;                      // of the decoded image, keys the IBL cache
+    std::vector<uint8_t> pixels;
+
+    bool isValid() const { return !pixels.empty(); }
+    size_t getRowSize() const { return (size_t)width * texelSize; }
+    const uint8_t* getRow(GLuint row) const { return pixels.data() + row * getRowSize(); }
+};
+
+// GL_RGBA16F, GL_RGB9_E5 or the decoded floats (GL_RGB32F / GL_RGBA32F), thread safe, no GL calls
+bool packHDRImage(const HDRImageData& image, GLenum internalFormat, HDRPackedImageData& packed);
+
+#endif
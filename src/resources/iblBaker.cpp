@@ -0,0 +1,538 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define IBLBAKER_SSE2
+#endif
+
+#include <glad/glad.h>
+
+#include <components/threadpool.h>
+
+#include "ktx.h"
+#include "iblBaker.h"
+#include "hdrPack.h"
+
+
+static const float PI = 3.14159265359f;
+static const GLuint bakeSampleCount = 1024;         // numSamples of integrateIBL.frag
+static const GLuint maxPrefilterSampleCount = 1024; // size of the PrefilterSamples block of prefilterIBL.frag
+static const GLuint referenceSampleCount = 4096;    // reference of the error report, CPU only so not bound by the block size
+
+
+// Four floats, an RGBA texel or four lanes of samples, SSE2 when available
+#ifdef IBLBAKER_SSE2
+typedef __m128 Float4;
+
+static inline Float4 set4(float value) { return _mm_set1_ps(value); }
+static inline Float4 load4(const float* values) { return _mm_loadu_ps(values); }
+static inline void store4(float* values, Float4 a) { _mm_storeu_ps(values, a); }
+static inline Float4 add4(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+static inline Float4 sub4(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+static inline Float4 mul4(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+static inline Float4 div4(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+static inline Float4 sqrt4(Float4 a) { return _mm_sqrt_ps(a); }
+static inline Float4 clamp4(Float4 a) { return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+static inline Float4 positiveOnly4(Float4 test, Float4 a) { return _mm_and_ps(_mm_cmpgt_ps(test, _mm_setzero_ps()), a); }
+#else
+struct Float4 { float v[4]; };
+
+template<typename F>
+static inline Float4 map4(F f) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = f(i); return r; }
+
+static inline Float4 set4(float value) { return map4([&](int) { return value; }); }
+static inline Float4 load4(const float* values) { return map4([&](int i) { return values[i]; }); }
+static inline void store4(float* values, Float4 a) { std::memcpy(values, a.v, sizeof(a.v)); }
+static inline Float4 add4(Float4 a, Float4 b) { return map4([&](int i) { return a.v[i] + b.v[i]; }); }
+static inline Float4 sub4(Float4 a, Float4 b) { return map4([&](int i) { return a.v[i] - b.v[i]; }); }
+static inline Float4 mul4(Float4 a, Float4 b) { return map4([&](int i) { return a.v[i] * b.v[i]; }); }
+static inline Float4 div4(Float4 a, Float4 b) { return map4([&](int i) { return a.v[i] / b.v[i]; }); }
+static inline Float4 sqrt4(Float4 a) { return map4([&](int i) { return std::sqrt(a.v[i]); }); }
+static inline Float4 clamp4(Float4 a) { return map4([&](int i) { return std::min(std::max(a.v[i], 0.0f), 1.0f); }); }
+static inline Float4 positiveOnly4(Float4 test, Float4 a) { return map4([&](int i) { return test.v[i] > 0.0f ? a.v[i] : 0.0f; }); }
+#endif
+
+
+static inline float sum4(Float4 a)
+{
+    float lanes[4];
+    store4(lanes, a);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+
+static inline Float4 lerp4(Float4 a, Float4 b, float t)
+{
+    return add4(a, mul4(sub4(b, a), set4(t)));
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+// Sampling
+// ---------------------------------------------------------------------------------------------------------------
+
+// direction through the center of a cube texel, the GL face layout (major axis, sc, tc) inverted
+static void getCubeTexelDirection(GLuint face, GLuint x, GLuint y, GLuint size, float* direction)
+{
+    float s = 2.0f * (x + 0.5f) / size - 1.0f;
+    float t = 2.0f * (y + 0.5f) / size - 1.0f;
+    float unnormalized[6][3] = { { 1.0f, -t, -s }, { -1.0f, -t, s }, { s, 1.0f, t }, { s, -1.0f, -t }, { s, -t, 1.0f }, { -s, -t, -1.0f } };
+
+    float length = std::sqrt(s * s + t * t + 1.0f);
+    for (int i = 0; i < 3; i++)
+        direction[i] = unnormalized[face][i] / length;
+}
+
+
+// bilinear fetch, (u, v) in texels of an RGBA image
+static inline Float4 sampleBilinear(const float* pixels, GLuint width, GLuint height, float u, float v, bool repeat)
+{
+    float x = u - 0.5f, y = v - 0.5f;
+    float x0f = std::floor(x), y0f = std::floor(y);
+    float fx = x - x0f, fy = y - y0f;
+    int x0 = (int)x0f, y0 = (int)y0f, x1 = x0 + 1, y1 = y0 + 1;
+
+    auto address = [repeat](int coordinate, GLuint size)
+    {
+        if (repeat)
+        {
+            int wrapped = coordinate % (int)size;
+            return wrapped < 0 ? wrapped + (int)size : wrapped;
+        }
+        return std::min(std::max(coordinate, 0), (int)size - 1);
+    };
+    x0 = address(x0, width); x1 = address(x1, width);
+    y0 = address(y0, height); y1 = address(y1, height);
+
+    Float4 top = lerp4(load4(pixels + ((size_t)y0 * width + x0) * 4), load4(pixels + ((size_t)y0 * width + x1) * 4), fx);
+    Float4 bottom = lerp4(load4(pixels + ((size_t)y1 * width + x0) * 4), load4(pixels + ((size_t)y1 * width + x1) * 4), fx);
+
+    return lerp4(top, bottom, fy);
+}
+
+
+// textureLod on a cubemap with linear mipmap linear filtering, faces are clamped to their edges (no seamless filtering)
+static Float4 sampleCube(const IBLCubeData& cube, const float* direction, float lod)
+{
+    float ax = std::fabs(direction[0]), ay = std::fabs(direction[1]), az = std::fabs(direction[2]);
+    GLuint face;
+    float sc, tc, ma;
+
+    if (ax >= ay && ax >= az)
+    {
+        face = direction[0] > 0.0f ? 0 : 1;
+        sc = direction[0] > 0.0f ? -direction[2] : direction[2];
+        tc = -direction[1];
+        ma = ax;
+    }
+    else if (ay >= az)
+    {
+        face = direction[1] > 0.0f ? 2 : 3;
+        sc = direction[0];
+        tc = direction[1] > 0.0f ? direction[2] : -direction[2];
+        ma = ay;
+    }
+    else
+    {
+        face = direction[2] > 0.0f ? 4 : 5;
+        sc = direction[2] > 0.0f ? direction[0] : -direction[0];
+        tc = -direction[1];
+        ma = az;
+    }
+
+    float s = 0.5f * (sc / ma + 1.0f);
+    float t = 0.5f * (tc / ma + 1.0f);
+
+    lod = std::min(std::max(lod, 0.0f), (float)(cube.levels - 1));
+    GLuint level0 = (GLuint)lod;
+    GLuint level1 = std::min(level0 + 1, cube.levels - 1);
+
+    GLuint size0 = cube.getLevelSize(level0);
+    Float4 color = sampleBilinear(cube.getFace(level0, face), size0, size0, s * size0, t * size0, false);
+    if (level1 != level0 && lod > level0)
+    {
+        GLuint size1 = cube.getLevelSize(level1);
+        color = lerp4(color, sampleBilinear(cube.getFace(level1, face), size1, size1, s * size1, t * size1, false), lod - level0);
+    }
+
+    return color;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+// Passes
+// ---------------------------------------------------------------------------------------------------------------
+
+static void allocateCube(GLuint size, GLuint levels, IBLCubeData& cube)
+{
+    cube.size = size;
+    cube.levels = levels;
+    cube.faces.assign(levels * 6, std::vector<float>());
+    for (GLuint level = 0; level < levels; level++)
+        for (GLuint face = 0; face < 6; face++)
+            cube.faces[level * 6 + face].assign((size_t)cube.getLevelSize(level) * cube.getLevelSize(level) * 4, 0.0f);
+}
+
+
+void bakeCubeFromLatlong(const float* pixels, GLuint width, GLuint height, GLuint components, GLuint size, IBLCubeData& cube)
+{
+    GLuint levels = 1;
+    while ((size >> levels) > 0)
+        levels++;
+    allocateCube(size, levels, cube);
+
+    // RGBA copy of the source so that a bilinear tap is four aligned loads
+    std::vector<float> source((size_t)width * height * 4, 1.0f);
+    for (size_t i = 0; i < (size_t)width * height; i++)
+        for (GLuint c = 0; c < 3; c++)
+            source[i * 4 + c] = pixels[i * components + c];
+
+    ThreadPool& pool = ThreadPool::shared();
+
+    pool.parallelFor(6 * size, [&](unsigned int row)
+    {
+        GLuint face = row / size, y = row % size;
+        float* destination = cube.getFace(0, face) + (size_t)y * size * 4;
+
+        for (GLuint x = 0; x < size; x++)
+        {
+            float direction[3];
+            getCubeTexelDirection(face, x, y, size, direction);
+
+            // getSphericalCoord of latlongToCube.frag
+            float phi = std::acos(-direction[1]);
+            float theta = std::atan2(direction[0], -direction[2]) + PI;
+            float u = theta / (2.0f * PI), v = phi / PI;
+
+            store4(destination + x * 4, sampleBilinear(source.data(), width, height, u * width, v * height, true));
+        }
+    });
+
+    for (GLuint level = 1; level < levels; level++)
+    {
+        GLuint levelSize = cube.getLevelSize(level), parentSize = cube.getLevelSize(level - 1);
+
+        pool.parallelFor(6 * levelSize, [&](unsigned int row)
+        {
+            GLuint face = row / levelSize, y = row % levelSize;
+            const float* parent = cube.getFace(level - 1, face);
+            float* destination = cube.getFace(level, face) + (size_t)y * levelSize * 4;
+
+            for (GLuint x = 0; x < levelSize; x++)
+            {
+                const float* topLeft = parent + ((size_t)(2 * y) * parentSize + 2 * x) * 4;
+                const float* bottomLeft = topLeft + (size_t)parentSize * 4;
+                Float4 sum = add4(add4(load4(topLeft), load4(topLeft + 4)), add4(load4(bottomLeft), load4(bottomLeft + 4)));
+                store4(destination + x * 4, mul4(sum, set4(0.25f)));
+            }
+        });
+    }
+}
+
+
+static float radicalInverse(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+    return float(bits) * 2.3283064365386963e-10f;
+}
+
+
+static float distributionGGX(float NdotH, float roughness)
+{
+    float alpha = roughness * roughness;
+    float alpha2 = alpha * alpha;
+    NdotH = std::min(std::max(NdotH, 0.0f), 1.0f);
+    float denominator = NdotH * NdotH * (alpha2 - 1.0f) + 1.0f;
+
+    return alpha2 / (PI * denominator * denominator);
+}
+
+
+GLuint getPrefilterSampleCount(float roughness)
+{
+    // Tuned with the bakeIBL report against 4096 samples: at the mirror end every sample is N, at the rough end
+    // the coarse source mips do most of the filtering, medium lobes are the ones that need samples
+    if (roughness <= 0.0f)
+        return 1;
+    if (roughness < 0.375f)
+        return 512;
+    if (roughness < 0.625f)
+        return 1024;
+
+    return 256;
+}
+
+
+std::vector<PrefilterSample> buildPrefilterSamples(float roughness, GLuint sourceSize, GLuint sampleCount)
+{
+    std::vector<PrefilterSample> samples;
+    float alpha = roughness * roughness;
+
+    for (GLuint i = 0; i < sampleCount; i++)
+    {
+        float xiX = float(i) / float(sampleCount), xiY = radicalInverse(i);
+
+        float anglePhi = 2.0f * PI * xiX;
+        float cosTheta = std::sqrt((1.0f - xiY) / (1.0f + (alpha * alpha - 1.0f) * xiY));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        float H[3] = { sinTheta * std::cos(anglePhi), sinTheta * std::sin(anglePhi), cosTheta };
+
+        // L = reflect(-V, H) with V = N = +Z
+        float L[3] = { 2.0f * cosTheta * H[0], 2.0f * cosTheta * H[1], 2.0f * cosTheta * H[2] - 1.0f };
+        if (L[2] <= 0.0f)
+            continue;
+
+        // mip of the source that covers the solid angle of the sample (Chetan Jags), with HdotV = NdotH
+        float NdotH = std::max(cosTheta, 0.0f);
+        float probability = distributionGGX(NdotH, roughness) * NdotH / (4.0f * NdotH) + 0.0001f;
+        float saTexel = 4.0f * PI / (6.0f * sourceSize * sourceSize);
+        float saSample = 1.0f / (float(sampleCount) * probability + 0.0001f);
+
+        PrefilterSample sample;
+        sample.direction[0] = L[0];
+        sample.direction[1] = L[1];
+        sample.direction[2] = L[2];
+        sample.lod = roughness == 0.0f ? 0.0f : std::max(0.5f * std::log2(saSample / saTexel), 0.0f);
+        samples.push_back(sample);
+    }
+
+    return samples;
+}
+
+
+static Float4 prefilterTexel(const IBLCubeData& source, const float* N, const std::vector<PrefilterSample>& samples, float totalWeight)
+{
+    // tangent frame of computeImportanceSampleGGX
+    float up[3] = { 0.0f, 0.0f, 1.0f };
+    if (std::fabs(N[2]) >= 0.999f)
+    {
+        up[0] = 1.0f;
+        up[2] = 0.0f;
+    }
+    float tangentX[3] = { up[1] * N[2] - up[2] * N[1], up[2] * N[0] - up[0] * N[2], up[0] * N[1] - up[1] * N[0] };
+    float length = std::sqrt(tangentX[0] * tangentX[0] + tangentX[1] * tangentX[1] + tangentX[2] * tangentX[2]);
+    for (auto& value : tangentX)
+        value /= length;
+    float tangentY[3] = { N[1] * tangentX[2] - N[2] * tangentX[1], N[2] * tangentX[0] - N[0] * tangentX[2], N[0] * tangentX[1] - N[1] * tangentX[0] };
+
+    Float4 accumulation = set4(0.0f);
+    for (auto& sample : samples)
+    {
+        float L[3];
+        for (int i = 0; i < 3; i++)
+            L[i] = tangentX[i] * sample.direction[0] + tangentY[i] * sample.direction[1] + N[i] * sample.direction[2];
+
+        accumulation = add4(accumulation, mul4(sampleCube(source, L, sample.lod), set4(sample.direction[2])));
+    }
+
+    return mul4(accumulation, set4(1.0f / totalWeight));
+}
+
+
+static float getTotalWeight(const std::vector<PrefilterSample>& samples)
+{
+    float totalWeight = 0.0f;
+    for (auto& sample : samples)
+        totalWeight += sample.direction[2];
+
+    return totalWeight;
+}
+
+
+// relative RMS difference with 4096 samples, on every 8th texel of each axis
+static float measurePrefilterError(const IBLCubeData& source, const IBLCubeData& prefiltered, GLuint level, float roughness)
+{
+    std::vector<PrefilterSample> reference = buildPrefilterSamples(roughness, source.size, referenceSampleCount);
+    float referenceWeight = getTotalWeight(reference);
+    GLuint levelSize = prefiltered.getLevelSize(level);
+    GLuint step = std::min(levelSize, 8u);
+
+    double errorSum = 0.0, referenceSum = 0.0;
+    for (GLuint face = 0; face < 6; face++)
+    {
+        for (GLuint y = step / 2; y < levelSize; y += step)
+        {
+            for (GLuint x = step / 2; x < levelSize; x += step)
+            {
+                float N[3], expected[4], baked[4];
+                getCubeTexelDirection(face, x, y, levelSize, N);
+                store4(expected, prefilterTexel(source, N, reference, referenceWeight));
+                std::memcpy(baked, prefiltered.getFace(level, face) + ((size_t)y * levelSize + x) * 4, sizeof(baked));
+
+                for (int c = 0; c < 3; c++)
+                {
+                    errorSum += (baked[c] - expected[c]) * (baked[c] - expected[c]);
+                    referenceSum += expected[c] * expected[c];
+                }
+            }
+        }
+    }
+
+    return referenceSum > 0.0 ? (float)std::sqrt(errorSum / referenceSum) : 0.0f;
+}
+
+
+void bakePrefilteredCube(const IBLCubeData& source, GLuint size, GLuint levels, IBLCubeData& prefiltered, std::vector<PrefilterLevelReport>* report)
+{
+    allocateCube(size, levels, prefiltered);
+    ThreadPool& pool = ThreadPool::shared();
+
+    if (report)
+        report->clear();
+
+    for (GLuint level = 0; level < levels; level++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        float roughness = levels > 1 ? (float)level / (float)(levels - 1) : 0.0f;
+        GLuint levelSize = prefiltered.getLevelSize(level);
+
+        std::vector<PrefilterSample> samples = buildPrefilterSamples(roughness, source.size, getPrefilterSampleCount(roughness));
+        float totalWeight = getTotalWeight(samples);
+
+        pool.parallelFor(6 * levelSize, [&](unsigned int row)
+        {
+            GLuint face = row / levelSize, y = row % levelSize;
+            float* destination = prefiltered.getFace(level, face) + (size_t)y * levelSize * 4;
+
+            for (GLuint x = 0; x < levelSize; x++)
+            {
+                float N[3];
+                getCubeTexelDirection(face, x, y, levelSize, N);
+                store4(destination + x * 4, prefilterTexel(source, N, samples, totalWeight));
+            }
+        });
+
+        if (report)
+        {
+            PrefilterLevelReport levelReport;
+            levelReport.level = level;
+            levelReport.roughness = roughness;
+            levelReport.sampleCount = getPrefilterSampleCount(roughness);
+            levelReport.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            levelReport.error = measurePrefilterError(source, prefiltered, level, roughness);
+            report->push_back(levelReport);
+        }
+    }
+}
+
+
+void bakeBRDFLUT(GLuint size, std::vector<float>& lut)
+{
+    lut.assign((size_t)size * size * 2, 0.0f);
+
+    // the Hammersley points only depend on the sample index, computeImportanceSampleGGX keeps phi for every roughness
+    const GLuint sampleCount = bakeSampleCount;
+    std::vector<float> cosPhi(sampleCount), sinPhi(sampleCount), xiY(sampleCount);
+    for (GLuint i = 0; i < sampleCount; i++)
+    {
+        float anglePhi = 2.0f * PI * (float(i) / float(sampleCount));
+        cosPhi[i] = std::cos(anglePhi);
+        sinPhi[i] = std::sin(anglePhi);
+        xiY[i] = radicalInverse(i);
+    }
+
+    ThreadPool::shared().parallelFor(size, [&](unsigned int y)
+    {
+        float roughness = (y + 0.5f) / size;
+        float alpha = roughness * roughness;
+        float kRough2 = roughness * roughness + 0.0001f;
+
+        for (GLuint x = 0; x < size; x++)
+        {
+            float NdotV = (x + 0.5f) / size;
+            float Vx = std::sqrt(1.0f - NdotV * NdotV), Vz = NdotV;
+            float NdotV2 = NdotV * NdotV;
+            float ggxV = (2.0f * NdotV) / (NdotV + std::sqrt(NdotV2 + kRough2 * (1.0f - NdotV2)));
+
+            // four samples per iteration, N = +Z so the tangent frame maps H to (Hy, -Hx, Hz)
+            Float4 scale = set4(0.0f), bias = set4(0.0f);
+            for (GLuint i = 0; i < sampleCount; i += 4)
+            {
+                Float4 one = set4(1.0f);
+                Float4 xi = load4(xiY.data() + i);
+                Float4 cosTheta = sqrt4(div4(sub4(one, xi), add4(one, mul4(set4(alpha * alpha - 1.0f), xi))));
+                Float4 sinTheta = sqrt4(sub4(one, mul4(cosTheta, cosTheta)));
+                Float4 Hx = mul4(sinTheta, load4(sinPhi.data() + i));
+                Float4 Hz = cosTheta;
+
+                Float4 VdotH = add4(mul4(set4(Vx), Hx), mul4(set4(Vz), Hz));
+                Float4 NdotL = clamp4(sub4(mul4(add4(VdotH, VdotH), Hz), set4(Vz)));
+                Float4 NdotH = clamp4(Hz);
+                VdotH = clamp4(VdotH);
+
+                Float4 NdotL2 = mul4(NdotL, NdotL);
+                Float4 ggxL = div4(add4(NdotL, NdotL), add4(NdotL, sqrt4(add4(NdotL2, mul4(set4(kRough2), sub4(one, NdotL2))))));
+                Float4 G = mul4(ggxL, set4(ggxV));
+                Float4 visibility = div4(mul4(G, VdotH), mul4(NdotH, set4(NdotV)));
+
+                Float4 fresnel = sub4(one, VdotH);
+                Float4 fresnel2 = mul4(fresnel, fresnel);
+                fresnel = mul4(mul4(fresnel2, fresnel2), fresnel);
+
+                visibility = positiveOnly4(NdotL, visibility);
+                scale = add4(scale, mul4(sub4(one, fresnel), visibility));
+                bias = add4(bias, mul4(fresnel, visibility));
+            }
+
+            lut[((size_t)y * size + x) * 2 + 0] = sum4(scale) / sampleCount;
+            lut[((size_t)y * size + x) * 2 + 1] = sum4(bias) / sampleCount;
+        }
+    });
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------------------------------------------
+
+// one face in the KTX layout: half floats, rows padded to 4 bytes
+static std::vector<unsigned char> packHalfFace(const float* pixels, GLuint width, GLuint height, GLuint stride, GLuint components, GLenum format)
+{
+    std::vector<unsigned char> face(getKTXFaceSize(width, height, format, GL_HALF_FLOAT), 0);
+    size_t rowSize = face.size() / height;
+
+    for (GLuint y = 0; y < height; y++)
+    {
+        uint16_t* row = (uint16_t*)(face.data() + y * rowSize);
+        for (GLuint x = 0; x < width; x++)
+            for (GLuint c = 0; c < components; c++)
+                row[x * components + c] = floatToHalf(pixels[((size_t)y * width + x) * stride + c]);
+    }
+
+    return face;
+}
+
+
+bool saveIBLCubeKTX(const std::string& path, const IBLCubeData& cube, GLuint levels)
+{
+    levels = std::min(levels, cube.levels);
+    std::vector<std::vector<unsigned char>> data(levels * 6);
+
+    for (GLuint level = 0; level < levels; level++)
+        for (GLuint face = 0; face < 6; face++)
+            data[level * 6 + face] = packHalfFace(cube.getFace(level, face), cube.getLevelSize(level), cube.getLevelSize(level), 4, 3, GL_RGB);
+
+    return saveFacesKTX(path, cube.size, cube.size, GL_RGB16F, GL_RGB, GL_HALF_FLOAT, 6, levels, data);
+}
+
+
+bool saveBRDFLUTKTX(const std::string& path, const std::vector<float>& lut, GLuint size)
+{
+    if (lut.size() != (size_t)size * size * 2)
+        return false;
+
+    std::vector<std::vector<unsigned char>> data(1, packHalfFace(lut.data(), size, size, 2, 2, GL_RG));
+
+    return saveFacesKTX(path, size, size, GL_RG16F, GL_RG, GL_HALF_FLOAT, 1, 1, data);
+}
@@ -0,0 +1,65 @@
+#ifndef IBLBAKER_H
+#define IBLBAKER_H
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+
+// CPU versions of the IBL bake passes (latlongToCube.frag, prefilterIBL.frag, integrateIBL.frag), same math and
+// same sample sets, for machines without a GPU. Texels are spread over the shared thread pool, every texel is
+// computed on its own in a fixed order so the result does not depend on the thread count.
+
+// Cubemap with its mip chain, faces in GL order (+X, -X, +Y, -Y, +Z, -Z), first row at t = 0 as GL stores them
+struct IBLCubeData
+{
+    GLuint size = 0;
+    GLuint levels = 0;
+    std::vector<std::vector<float>> faces;      // level * 6 + face, RGBA floats (alpha unused, one texel per SSE register)
+
+    GLuint getLevelSize(GLuint level) const { return size >> level > 0 ? size >> level : 1; }
+    float* getFace(GLuint level, GLuint face) { return faces[level * 6 + face].data(); }
+    const float* getFace(GLuint level, GLuint face) const { return faces[level * 6 + face].data(); }
+};
+
+
+// latlongToCube.frag then glGenerateMipmap (2x2 box), the latlong image is float rgb or rgba, first row at the bottom
+void bakeCubeFromLatlong(const float* pixels, GLuint width, GLuint height, GLuint components, GLuint size, IBLCubeData& cube);
+
+// Importance sampled light direction in the tangent frame of N (N = V = +Z) and the source mip it reads,
+// one vec4 of the PrefilterSamples uniform block of prefilterIBL.frag. NdotL is direction[2]
+struct PrefilterSample
+{
+    float direction[3];
+    float lod;
+};
+
+// Samples for one roughness level, at most 1024 (the size of the uniform block) except for the CPU error reference
+GLuint getPrefilterSampleCount(float roughness);
+
+// GGX samples of one roughness level, computed once per level instead of per texel,
+// sourceSize is the width of the level 0 faces of the mipmapped source cube
+std::vector<PrefilterSample> buildPrefilterSamples(float roughness, GLuint sourceSize, GLuint sampleCount);
+
+struct PrefilterLevelReport
+{
+    GLuint level;
+    float roughness;
+    GLuint sampleCount;
+    float milliseconds;
+    float error;                // relative RMS error against 4096 samples, on a sparse grid of texels
+};
+
+// prefilterIBL.frag for each roughness level, source is the mipmapped environment cube
+void bakePrefilteredCube(const IBLCubeData& source, GLuint size, GLuint levels, IBLCubeData& prefiltered,
+                         std::vector<PrefilterLevelReport>* report = nullptr);
+
+// integrateIBL.frag, size x size RG floats, x = NdotV, y = roughness
+void bakeBRDFLUT(GLuint size, std::vector<float>& lut);
+
+// RGB / RG half floats, the layout of saveTextureKTX
+bool saveIBLCubeKTX(const std::string& path, const IBLCubeData& cube, GLuint levels);
+bool saveBRDFLUTKTX(const std::string& path, const std::vector<float>& lut, GLuint size);
+
+#endif
@@ -0,0 +1,62 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <filesystem>
+
+#include "contentHash.h"
+#include "iblCache.h"
+
+
+static const char* iblCacheFolder = "resources/cache/ibl";
+static const char* brdfLUTFolder = "resources/textures/ibl";
+static const uint64_t iblCacheVersion = 1;          // bump when the file layout changes
+
+
+uint64_t getIBLBakeKey(uint64_t environmentHash, const IBLBakeSettings& settings)
+{
+    uint64_t key = hashMix(iblCacheVersion, environmentHash);
+    key = hashMix(key, settings.cubeSize);
+    key = hashMix(key, settings.prefilterSize);
+    key = hashMix(key, settings.prefilterLevels);
+    key = hashMix(key, settings.shaderHash);
+
+    return key;
+}
+
+
+uint64_t getIBLShaderHash(const std::vector<std::string>& shaderPaths)
+{
+    uint64_t hash = 0;
+    for (auto& path : shaderPaths)
+        hash = hashMix(hash, hashFile(path));
+
+    return hash;
+}
+
+
+std::vector<std::string> getIBLBakeShaders()
+{
+    return { "resources/shaders/lighting/cubeLayered.geom", "resources/shaders/latlongToCube.frag", "resources/shaders/lighting/prefilterIBL.frag",
+             "resources/shaders/latlongToCube.comp", "resources/shaders/lighting/prefilterIBL.comp" };
+}
+
+
+std::string getBRDFLUTPath(const IBLBakeSettings& settings)
+{
+    std::error_code error;
+    std::filesystem::create_directories(brdfLUTFolder, error);
+
+    return std::string(brdfLUTFolder) + "/brdfLUT" + std::to_string(settings.lutSize) + ".ktx";
+}
+
+
+std::string getIBLCachePath(uint64_t bakeKey, const std::string& product)
+{
+    std::error_code error;
+    std::filesystem::create_directories(iblCacheFolder, error);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)bakeKey);
+
+    return std::string(iblCacheFolder) + '/' + name + '.' + product + ".ktx";
+}
@@ -0,0 +1,33 @@
+#ifndef IBLCACHE_H
+#define IBLCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+
+// Everything that changes the result of an IBL bake besides the environment itself
+// The defaults are the sizes the engine allocates, the offline baker (src/tools/bakeIBL.cpp) uses the same ones
+struct IBLBakeSettings
+{
+    GLuint cubeSize = 512;
+    GLuint prefilterSize = 128;
+    GLuint prefilterLevels = 5;
+    GLuint lutSize = 512;                   // not part of the bake key, the LUT is an asset of its own (getBRDFLUTPath)
+    uint64_t shaderHash = 0;        // sources of the bake shaders, editing one invalidates the cache
+};
+
+
+// Baked IBL products (prefiltered cubemap) are stored as KTX files in resources/cache/ibl,
+// named after the environment content hash and the bake settings, so switching back to an environment is a file read
+uint64_t getIBLBakeKey(uint64_t environmentHash, const IBLBakeSettings& settings);
+uint64_t getIBLShaderHash(const std::vector<std::string>& shaderPaths);
+std::vector<std::string> getIBLBakeShaders();       // the shaders whose math the bake depends on, GPU and CPU bakers alike
+std::string getIBLCachePath(uint64_t bakeKey, const std::string& product);      // creates the cache folder if needed
+
+// The split-sum BRDF LUT does not depend on the environment, it ships with the resources (baked by bakeIBL on the CPU)
+std::string getBRDFLUTPath(const IBLBakeSettings& settings);                     // creates the folder if needed
+
+#endif
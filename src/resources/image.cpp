@@ -0,0 +1,360 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include <components/threadpool.h>
+
+#include "stb_image.h"
+#include "image.h"
+#include "radianceHDR.h"
+#include "contentHash.h"
+
+
+bool loadImageData(const std::string& path, ImageData& image)
+{
+    // The stb flip flag is global state shared with the render thread, it always stays false
+    // and textures that need flipping are flipped by hand (see flipImageVertically)
+    int width, height, numComponents;
+    unsigned char* texData = stbi_load(path.c_str(), &width, &height, &numComponents, 0);
+
+    image.path = path;
+
+    if (!texData)
+    {
+        std::cerr << "IMAGE - FAILED LOADING : " << path << std::endl;
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.components = numComponents;
+    image.format = getFormatFromComponents(numComponents);
+    image.internalFormat = image.format;
+    image.pixels.assign(texData, texData + (size_t)width * height * numComponents);
+    image.hash = hashBytes(image.pixels.data(), image.pixels.size(), hashMix(width, ((uint64_t)height << 8) | numComponents));
+
+    stbi_image_free(texData);
+
+    return true;
+}
+
+
+bool loadHDRImageData(const std::string& path, bool flip, HDRImageData& image, GLuint reduction)
+{
+    if (!isRadianceHDR(path))
+    {
+        std::cerr << "HDR TEXTURE - FILE IS NOT HDR : " << path << std::endl;
+        return false;
+    }
+
+    if (!decodeRadianceHDR(path, flip, reduction, image))
+    {
+        std::cerr << "HDR TEXTURE - FAILED LOADING : " << path << std::endl;
+        image.pixels.clear();
+        return false;
+    }
+
+    image.hash = hashBytes(image.pixels.data(), image.pixels.size() * sizeof(float), hashMix(image.width, image.height));
+
+    return true;
+}
+
+
+GLuint uploadImageData(const ImageData& image)
+{
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+
+    if (!image.isValid())
+        return textureID;
+
+    // the levels come from buildImageMips or a cooked file, the driver never filters them
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);     // RGB and RED rows are not 4 bytes aligned
+    for (GLuint level = 0; level < image.getLevelCount(); level++)
+    {
+        if (image.isCompressed())
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, image.getLevelWidth(level), image.getLevelHeight(level), 0, (GLsizei)image.getLevelSize(level), image.getLevelPixels(level));
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, image.getLevelWidth(level), image.getLevelHeight(level), 0, image.format, GL_UNSIGNED_BYTE, image.getLevelPixels(level));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.getLevelCount() - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return textureID;
+}
+
+
+// Kaiser windowed sinc over 3 destination texels, sharper than a box or a tent without the ringing of a plain sinc
+static float mipKernel(float x)
+{
+    const float width = 3.0f;
+    const float alpha = 4.0f;
+    const float pi = 3.14159265358979f;
+
+    auto besselI0 = [](float value)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 16; k++)
+        {
+            term *= (value / (2.0f * k)) * (value / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    };
+
+    x = std::fabs(x);
+    if (x >= width)
+        return 0.0f;
+
+    float sinc = x < 1e-5f ? 1.0f : std::sin(pi * x) / (pi * x);
+    float t = x / width;
+
+    return sinc * besselI0(alpha * std::sqrt(1.0f - t * t)) / besselI0(alpha);
+}
+
+
+struct MipTaps
+{
+    int first;
+    std::vector<float> weights;
+};
+
+
+// weights of the source texels for each destination texel of one axis, the texture repeats so taps wrap around
+static std::vector<MipTaps> buildMipTaps(GLuint srcSize, GLuint dstSize)
+{
+    std::vector<MipTaps> taps(dstSize);
+    float scale = (float)srcSize / dstSize;
+
+    for (GLuint d = 0; d < dstSize; d++)
+    {
+        if (srcSize == dstSize)
+        {
+            taps[d].first = d;
+            taps[d].weights.assign(1, 1.0f);
+            continue;
+        }
+
+        float center = (d + 0.5f) * scale;
+        float radius = 3.0f * scale;
+        int first = (int)std::floor(center - radius);
+        int last = (int)std::ceil(center + radius);
+
+        float sum = 0.0f;
+        taps[d].first = first;
+        for (int s = first; s < last; s++)
+        {
+            float weight = mipKernel((s + 0.5f - center) / scale);
+            taps[d].weights.push_back(weight);
+            sum += weight;
+        }
+        for (auto& weight : taps[d].weights)
+            weight /= sum;
+    }
+
+    return taps;
+}
+
+
+static inline GLuint wrapTexel(int texel, GLuint size)
+{
+    int wrapped = texel % (int)size;
+    return wrapped < 0 ? wrapped + size : wrapped;
+}
+
+
+void buildImageMips(ImageData& image, TextureUsage usage)
+{
+    if (!image.isValid() || image.isCompressed() || !image.levelOffsets.empty())
+        return;
+
+    GLuint levels = 1;
+    while ((image.width >> levels) > 0 || (image.height >> levels) > 0)
+        levels++;
+
+    image.levelOffsets.resize(levels);
+    size_t totalSize = 0;
+    for (GLuint level = 0; level < levels; level++)
+    {
+        image.levelOffsets[level] = totalSize;
+        totalSize += image.getLevelSize(level);
+    }
+    image.pixels.resize(totalSize);
+
+    // Color textures are sRGB encoded, averaging the encoded values darkens the mips: filter in linear space.
+    // Alpha, normals and masks are linear already.
+    GLuint components = image.components;
+    bool gammaCorrect = usage == TextureUsage::Color;
+    bool renormalize = usage == TextureUsage::Normal && components >= 3;
+
+    float toLinear[256];
+    unsigned char toSRGB[4096];
+    for (int i = 0; i < 256; i++)
+    {
+        float value = i / 255.0f;
+        toLinear[i] = gammaCorrect ? (value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f)) : value;
+    }
+    for (int i = 0; i < 4096; i++)
+    {
+        float value = i / 4095.0f;
+        float encoded = gammaCorrect ? (value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f) : value;
+        toSRGB[i] = (unsigned char)(encoded * 255.0f + 0.5f);
+    }
+    auto isLinearChannel = [components](GLuint c) { return components == 4 && c == 3; };
+
+    const GLuint tileRows = 16;
+    ThreadPool& pool = ThreadPool::shared();
+
+    std::vector<float> current((size_t)image.width * image.height * components);
+    pool.parallelFor((image.height + tileRows - 1) / tileRows, [&](unsigned int tile)
+    {
+        for (GLuint y = tile * tileRows; y < std::min((tile + 1) * tileRows, image.height); y++)
+        {
+            for (size_t i = (size_t)y * image.width * components; i < (size_t)(y + 1) * image.width * components; i++)
+                current[i] = isLinearChannel(i % components) ? image.pixels[i] / 255.0f : toLinear[image.pixels[i]];
+        }
+    });
+
+    // each level filters the previous one, separable: horizontal pass then vertical pass, tiles of rows run in parallel
+    std::vector<float> horizontal, next;
+    for (GLuint level = 1; level < levels; level++)
+    {
+        GLuint srcWidth = image.getLevelWidth(level - 1);
+        GLuint srcHeight = image.getLevelHeight(level - 1);
+        GLuint dstWidth = image.getLevelWidth(level);
+        GLuint dstHeight = image.getLevelHeight(level);
+        std::vector<MipTaps> tapsX = buildMipTaps(srcWidth, dstWidth);
+        std::vector<MipTaps> tapsY = buildMipTaps(srcHeight, dstHeight);
+
+        horizontal.assign((size_t)dstWidth * srcHeight * components, 0.0f);
+        pool.parallelFor((srcHeight + tileRows - 1) / tileRows, [&](unsigned int tile)
+        {
+            for (GLuint y = tile * tileRows; y < std::min((tile + 1) * tileRows, srcHeight); y++)
+            {
+                const float* srcRow = current.data() + (size_t)y * srcWidth * components;
+                float* dstRow = horizontal.data() + (size_t)y * dstWidth * components;
+
+                for (GLuint x = 0; x < dstWidth; x++)
+                {
+                    const MipTaps& taps = tapsX[x];
+                    for (size_t t = 0; t < taps.weights.size(); t++)
+                    {
+                        const float* texel = srcRow + (size_t)wrapTexel(taps.first + (int)t, srcWidth) * components;
+                        for (GLuint c = 0; c < components; c++)
+                            dstRow[x * components + c] += texel[c] * taps.weights[t];
+                    }
+                }
+            }
+        });
+
+        next.assign((size_t)dstWidth * dstHeight * components, 0.0f);
+        unsigned char* pixels = image.pixels.data() + image.levelOffsets[level];
+        pool.parallelFor((dstHeight + tileRows - 1) / tileRows, [&](unsigned int tile)
+        {
+            for (GLuint y = tile * tileRows; y < std::min((tile + 1) * tileRows, dstHeight); y++)
+            {
+                float* dstRow = next.data() + (size_t)y * dstWidth * components;
+                const MipTaps& taps = tapsY[y];
+
+                for (size_t t = 0; t < taps.weights.size(); t++)
+                {
+                    const float* srcRow = horizontal.data() + (size_t)wrapTexel(taps.first + (int)t, srcHeight) * dstWidth * components;
+                    for (size_t i = 0; i < (size_t)dstWidth * components; i++)
+                        dstRow[i] += srcRow[i] * taps.weights[t];
+                }
+
+                for (GLuint x = 0; x < dstWidth; x++)
+                {
+                    float* texel = dstRow + x * components;
+
+                    if (renormalize)
+                    {
+                        float nx = texel[0] * 2.0f - 1.0f, ny = texel[1] * 2.0f - 1.0f, nz = texel[2] * 2.0f - 1.0f;
+                        float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+                        if (length > 1e-6f)
+                        {
+                            texel[0] = (nx / length) * 0.5f + 0.5f;
+                            texel[1] = (ny / length) * 0.5f + 0.5f;
+                            texel[2] = (nz / length) * 0.5f + 0.5f;
+                        }
+                    }
+
+                    for (GLuint c = 0; c < components; c++)
+                    {
+                        float value = std::min(std::max(texel[c], 0.0f), 1.0f);
+                        texel[c] = value;
+                        pixels[((size_t)y * dstWidth + x) * components + c] = isLinearChannel(c) ? (unsigned char)(value * 255.0f + 0.5f) : toSRGB[(int)(value * 4095.0f + 0.5f)];
+                    }
+                }
+            }
+        });
+
+        current.swap(next);
+    }
+}
+
+
+void flipImageVertically(void* pixels, GLuint width, GLuint height, GLuint bytesPerPixel)
+{
+    size_t rowSize = (size_t)width * bytesPerPixel;
+    std::vector<unsigned char> tempRow(rowSize);
+    unsigned char* data = (unsigned char*)pixels;
+
+    for (GLuint y = 0; y < height / 2; y++)
+    {
+        unsigned char* rowTop = data + y * rowSize;
+        unsigned char* rowBottom = data + (height - 1 - y) * rowSize;
+        std::memcpy(tempRow.data(), rowTop, rowSize);
+        std::memcpy(rowTop, rowBottom, rowSize);
+        std::memcpy(rowBottom, tempRow.data(), rowSize);
+    }
+}
+
+
+void expandGreyAlpha(ImageData& image)
+{
+    if (image.components != 2 || !image.levelOffsets.empty())
+        return;
+
+    size_t texelCount = (size_t)image.width * image.height;
+    std::vector<unsigned char> pixels(texelCount * 4);
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        pixels[i * 4 + 0] = image.pixels[i * 2];
+        pixels[i * 4 + 1] = image.pixels[i * 2];
+        pixels[i * 4 + 2] = image.pixels[i * 2];
+        pixels[i * 4 + 3] = image.pixels[i * 2 + 1];
+    }
+
+    image.pixels.swap(pixels);
+    image.components = 4;
+    image.format = GL_RGBA;
+    image.internalFormat = GL_RGBA;
+    image.hash = hashBytes(image.pixels.data(), image.pixels.size(), hashMix(image.width, ((uint64_t)image.height << 8) | 4));
+}
+
+
+GLenum getFormatFromComponents(GLuint components)
+{
+    if (components == 1)
+        return GL_RED;
+    else if (components == 2)
+        return GL_RG;
+    else if (components == 4)
+        return GL_RGBA;
+
+    return GL_RGB;
+}
@@ -0,0 +1,78 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+
+// What a material texture holds, decides how its mips are filtered and the block format it is cooked to
+enum class TextureUsage
+{
+    Color,      // albedo, sRGB encoded: filtered in linear space, BC1, or BC3 / BC7 with alpha
+    Normal,     // tangent space normal: renormalized mips, BC5, z is rebuilt in the shader
+    Mask        // single channel map (roughness, metalness, ao): BC4
+};
+
+
+// CPU side copy of a decoded image
+// Filled on a worker thread, then handed to the render thread for the upload
+struct ImageData
+{
+    std::string path;
+    GLuint width = 0;
+    GLuint height = 0;
+    GLuint components = 0;
+    GLenum format = GL_RGB;
+    GLenum internalFormat = GL_RGB;         // compressed format when blockSize is not 0
+    GLuint blockSize = 0;                   // bytes per 4x4 block of a block compressed image, 0 for plain pixels
+    uint64_t hash = 0;                      // content hash of the decoded pixels (see contentHash.h)
+    std::vector<unsigned char> pixels;      // base level, followed by the mip levels once built
+    std::vector<size_t> levelOffsets;       // byte offset of each level in pixels, empty until buildImageMips
+
+    bool isValid() const { return !pixels.empty(); }
+    bool isCompressed() const { return blockSize != 0; }
+    GLuint getLevelCount() const { return levelOffsets.empty() ? 1 : (GLuint)levelOffsets.size(); }
+    GLuint getLevelWidth(GLuint level) const { return std::max(width >> level, 1u); }
+    GLuint getLevelHeight(GLuint level) const { return std::max(height >> level, 1u); }
+    const unsigned char* getLevelPixels(GLuint level) const { return pixels.data() + (levelOffsets.empty() ? 0 : levelOffsets[level]); }
+
+    // a row is one line of pixels, or one line of 4x4 blocks for compressed images
+    GLuint getRowHeight() const { return isCompressed() ? 4 : 1; }
+    GLuint getLevelRowCount(GLuint level) const { return (getLevelHeight(level) + getRowHeight() - 1) / getRowHeight(); }
+    size_t getLevelRowSize(GLuint level) const
+    {
+        if (isCompressed())
+            return (size_t)((getLevelWidth(level) + 3) / 4) * blockSize;
+        return (size_t)getLevelWidth(level) * components;
+    }
+    size_t getLevelSize(GLuint level) const { return getLevelRowSize(level) * getLevelRowCount(level); }
+};
+
+
+// Decoded floating point image (.hdr), rgb floats
+struct HDRImageData
+{
+    std::string path;
+    GLuint width = 0;
+    GLuint height = 0;
+    GLuint components = 0;
+    uint64_t hash = 0;                      // content hash of the pixels as stored (after the flip), keys the IBL cache
+    std::vector<float> pixels;
+
+    bool isValid() const { return !pixels.empty(); }
+};
+
+
+bool loadImageData(const std::string& path, ImageData& image);       // Thread safe, no GL calls
+bool loadHDRImageData(const std::string& path, bool flip, HDRImageData& image, GLuint reduction = 1);   // Thread safe, no GL calls, see radianceHDR.h
+GLuint uploadImageData(const ImageData& image);                        // Render thread only
+void buildImageMips(ImageData& image, TextureUsage usage = TextureUsage::Color);   // Thread safe, appends the full mip chain to the pixels
+void flipImageVertically(void* pixels, GLuint width, GLuint height, GLuint bytesPerPixel);
+void expandGreyAlpha(ImageData& image);         // grey + alpha (2 channels) to RGBA, base level only, before buildImageMips
+GLenum getFormatFromComponents(GLuint components);
+
+#endif
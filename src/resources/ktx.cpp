@@ -0,0 +1,354 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "image.h"
+#include "contentHash.h"
+#include "ktx.h"
+
+
+static const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct KTXHeader
+{
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+
+static GLuint getBlockSizeFromFormat(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+        case 0x83F0:    // BC1 (GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        case 0x8DBB:    // BC4 (GL_COMPRESSED_RED_RGTC1)
+            return 8;
+        case 0x83F3:    // BC3 (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        case 0x8DBD:    // BC5 (GL_COMPRESSED_RG_RGTC2)
+        case 0x8E8C:    // BC7 (GL_COMPRESSED_RGBA_BPTC_UNORM)
+            return 16;
+    }
+
+    return 0;
+}
+
+
+bool saveKTX(const std::string& path, const ImageData& image)
+{
+    if (!image.isValid())
+        return false;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    KTXHeader header;
+    std::memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+    header.endianness = 0x04030201;
+    header.glType = image.isCompressed() ? 0 : GL_UNSIGNED_BYTE;
+    header.glTypeSize = 1;
+    header.glFormat = image.isCompressed() ? 0 : image.format;
+    header.glInternalFormat = image.internalFormat;
+    header.glBaseInternalFormat = image.format;
+    header.pixelWidth = image.width;
+    header.pixelHeight = image.height;
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = image.getLevelCount();
+    header.bytesOfKeyValueData = 0;
+    file.write((const char*)&header, sizeof(header));
+
+    // each level starts on 4 bytes, rows of plain images are padded to 4 bytes (GL_UNPACK_ALIGNMENT 4) as KTX 1.1 requires,
+    // block rows are always a multiple of 8 bytes
+    static const char padding[4] = { 0, 0, 0, 0 };
+    for (GLuint level = 0; level < image.getLevelCount(); level++)
+    {
+        size_t rowSize = image.getLevelRowSize(level);
+        size_t rowPadding = image.isCompressed() ? 0 : (4 - rowSize % 4) % 4;
+        GLuint rowCount = image.getLevelRowCount(level);
+        uint32_t levelSize = (uint32_t)((rowSize + rowPadding) * rowCount);
+        file.write((const char*)&levelSize, sizeof(levelSize));
+
+        const unsigned char* pixels = image.getLevelPixels(level);
+        if (rowPadding == 0)
+            file.write((const char*)pixels, levelSize);
+        else
+        {
+            for (GLuint row = 0; row < rowCount; row++)
+            {
+                file.write((const char*)pixels + row * rowSize, rowSize);
+                file.write(padding, rowPadding);
+            }
+        }
+        file.write(padding, (4 - levelSize % 4) % 4);
+    }
+
+    return (bool)file;
+}
+
+
+bool loadKTX(const std::string& path, ImageData& image)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    KTXHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || std::memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0)
+    {
+        std::cerr << "KTX - INVALID FILE : " << path << std::endl;
+        return false;
+    }
+
+    if (header.endianness != 0x04030201 || header.numberOfFaces != 1 || header.pixelDepth > 1 || header.numberOfArrayElements > 1)
+    {
+        std::cerr << "KTX - UNSUPPORTED LAYOUT : " << path << std::endl;
+        return false;
+    }
+
+    GLuint blockSize = getBlockSizeFromFormat(header.glInternalFormat);
+    if (header.glType == 0 && blockSize == 0)
+    {
+        std::cerr << "KTX - UNSUPPORTED FORMAT : " << path << std::endl;
+        return false;
+    }
+
+    image.path = path;
+    image.width = header.pixelWidth;
+    image.height = header.pixelHeight;
+    image.format = header.glBaseInternalFormat;
+    image.internalFormat = header.glInternalFormat;
+    image.blockSize = header.glType == 0 ? blockSize : 0;
+    image.components = header.glBaseInternalFormat == GL_RED ? 1 : header.glBaseInternalFormat == GL_RG ? 2 : header.glBaseInternalFormat == GL_RGBA ? 4 : 3;
+
+    file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    GLuint levels = std::max(header.numberOfMipmapLevels, 1u);
+    image.levelOffsets.resize(levels);
+    image.pixels.clear();
+
+    for (GLuint level = 0; level < levels; level++)
+    {
+        uint32_t levelSize = 0;
+        file.read((char*)&levelSize, sizeof(levelSize));
+
+        // rows are stored padded to 4 bytes, kept tightly packed in memory
+        size_t rowSize = image.getLevelRowSize(level);
+        size_t rowPadding = image.isCompressed() ? 0 : (4 - rowSize % 4) % 4;
+        GLuint rowCount = image.getLevelRowCount(level);
+
+        if (!file || levelSize != (rowSize + rowPadding) * rowCount)
+        {
+            std::cerr << "KTX - TRUNCATED FILE : " << path << std::endl;
+            image.pixels.clear();
+            return false;
+        }
+
+        image.levelOffsets[level] = image.pixels.size();
+        image.pixels.resize(image.pixels.size() + rowSize * rowCount);
+        unsigned char* pixels = image.pixels.data() + image.levelOffsets[level];
+        if (rowPadding == 0)
+            file.read((char*)pixels, levelSize);
+        else
+        {
+            for (GLuint row = 0; row < rowCount; row++)
+            {
+                file.read((char*)pixels + row * rowSize, rowSize);
+                file.seekg(rowPadding, std::ios::cur);
+            }
+        }
+        file.seekg((4 - levelSize % 4) % 4, std::ios::cur);
+    }
+
+    if (!file)
+    {
+        image.pixels.clear();
+        return false;
+    }
+
+    if (levels == 1)
+        image.levelOffsets.clear();
+
+    image.hash = hashBytes(image.pixels.data(), image.pixels.size(), hashMix(hashMix(image.width, image.height), image.internalFormat));
+
+    return true;
+}
+
+
+static GLuint getComponentsFromFormat(GLenum format)
+{
+    if (format == GL_RED)
+        return 1;
+    else if (format == GL_RG)
+        return 2;
+    else if (format == GL_RGBA)
+        return 4;
+
+    return 3;
+}
+
+
+static GLuint getTypeSize(GLenum type)
+{
+    if (type == GL_FLOAT)
+        return 4;
+    else if (type == GL_HALF_FLOAT)
+        return 2;
+
+    return 1;
+}
+
+
+size_t getKTXFaceSize(GLuint width, GLuint height, GLenum format, GLenum type)
+{
+    size_t rowSize = (size_t)width * getComponentsFromFormat(format) * getTypeSize(type);
+    return ((rowSize + 3) & ~(size_t)3) * height;
+}
+
+
+bool saveFacesKTX(const std::string& path, GLuint width, GLuint height, GLenum internalFormat, GLenum format, GLenum type,
+                  GLuint faces, GLuint levels, const std::vector<std::vector<unsigned char>>& data)
+{
+    if (data.size() != (size_t)levels * faces)
+        return false;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    KTXHeader header;
+    std::memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+    header.endianness = 0x04030201;
+    header.glType = type;
+    header.glTypeSize = getTypeSize(type);
+    header.glFormat = format;
+    header.glInternalFormat = internalFormat;
+    header.glBaseInternalFormat = format;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = faces;
+    header.numberOfMipmapLevels = levels;
+    header.bytesOfKeyValueData = 0;
+    file.write((const char*)&header, sizeof(header));
+
+    for (GLuint level = 0; level < levels; level++)
+    {
+        uint32_t faceSize = (uint32_t)getKTXFaceSize(std::max(width >> level, 1u), std::max(height >> level, 1u), format, type);
+        file.write((const char*)&faceSize, sizeof(faceSize));
+
+        for (GLuint face = 0; face < faces; face++)
+        {
+            const std::vector<unsigned char>& faceData = data[level * faces + face];
+            if (faceData.size() != faceSize)
+                return false;
+            file.write((const char*)faceData.data(), faceSize);
+        }
+    }
+
+    return (bool)file;
+}
+
+
+bool saveTextureKTX(const std::string& path, GLuint textureID, GLenum target, GLenum format, GLenum type, GLuint levels)
+{
+    GLuint faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+    GLint width = 0, height = 0, internalFormat = 0;
+
+    glBindTexture(target, textureID);
+    glGetTexLevelParameteriv(faceTarget, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(faceTarget, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(faceTarget, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+    // the default pack alignment of 4 gives the KTX row layout
+    std::vector<std::vector<unsigned char>> data(levels * faces);
+    for (GLuint level = 0; level < levels; level++)
+    {
+        size_t faceSize = getKTXFaceSize(std::max(width >> level, 1), std::max(height >> level, 1), format, type);
+
+        for (GLuint face = 0; face < faces; face++)
+        {
+            data[level * faces + face].resize(faceSize);
+            glGetTexImage(faceTarget + face, level, format, type, data[level * faces + face].data());
+        }
+    }
+
+    glBindTexture(target, 0);
+
+    return saveFacesKTX(path, width, height, internalFormat, format, type, faces, levels, data);
+}
+
+
+bool loadTextureKTX(const std::string& path, GLuint textureID, GLenum target)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    GLuint faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+
+    KTXHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || std::memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0
+        || header.endianness != 0x04030201 || header.numberOfFaces != faces || header.glType == 0)
+    {
+        std::cerr << "KTX - INVALID FILE : " << path << std::endl;
+        return false;
+    }
+
+    file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    // read everything first, a truncated file must not leave the texture half updated
+    GLuint levels = std::max(header.numberOfMipmapLevels, 1u);
+    std::vector<std::vector<unsigned char>> data(levels * faces);
+    for (GLuint level = 0; level < levels; level++)
+    {
+        uint32_t faceSize = 0;
+        file.read((char*)&faceSize, sizeof(faceSize));
+
+        if (!file || faceSize != getKTXFaceSize(std::max(header.pixelWidth >> level, 1u), std::max(header.pixelHeight >> level, 1u), header.glFormat, header.glType))
+        {
+            std::cerr << "KTX - TRUNCATED FILE : " << path << std::endl;
+            return false;
+        }
+
+        for (GLuint face = 0; face < faces; face++)
+        {
+            data[level * faces + face].resize(faceSize);
+            file.read((char*)data[level * faces + face].data(), faceSize);
+        }
+    }
+
+    if (!file)
+        return false;
+
+    glBindTexture(target, textureID);
+    for (GLuint level = 0; level < levels; level++)
+        for (GLuint face = 0; face < faces; face++)
+            glTexImage2D(faceTarget + face, level, header.glInternalFormat, std::max(header.pixelWidth >> level, 1u), std::max(header.pixelHeight >> level, 1u), 0,
+                         header.glFormat, header.glType, data[level * faces + face].data());
+    glBindTexture(target, 0);
+
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+
+// KTX 1.1 container (2D, single face), used for the cooked textures and their full mip chains
+// Both block compressed and plain 8 bits images are supported
+bool saveKTX(const std::string& path, const ImageData& image);      // Thread safe
+bool loadKTX(const std::string& path, ImageData& image);            // Thread safe
+
+// Uncompressed 2D or cubemap levels already in memory, data holds one entry per level and face (level * faces + face)
+// laid out as KTX stores them: rows padded to 4 bytes, see getKTXFaceSize. Thread safe, no GL calls
+bool saveFacesKTX(const std::string& path, GLuint width, GLuint height, GLenum internalFormat, GLenum format, GLenum type,
+                  GLuint faces, GLuint levels, const std::vector<std::vector<unsigned char>>& data);
+size_t getKTXFaceSize(GLuint width, GLuint height, GLenum format, GLenum type);
+
+// Reads back / restores a whole GPU texture (2D or cubemap, every level), used to cache baked products
+// Render thread only, loading into a texture redefines its levels with the stored size and format
+bool saveTextureKTX(const std::string& path, GLuint textureID, GLenum target, GLenum format, GLenum type, GLuint levels);
+bool loadTextureKTX(const std::string& path, GLuint textureID, GLenum target);
+
+#endif
@@ -0,0 +1,439 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define RADIANCEHDR_SSE2
+#endif
+
+#include <glad/glad.h>
+
+#include <components/threadpool.h>
+
+#include "image.h"
+#include "radianceHDR.h"
+
+
+// output rows per decoding job
+static const GLuint decodeRowsPerJob = 16;
+
+
+// Read only view of a whole file, unmapped when it goes out of scope
+class MappedFile
+{
+    public:
+        MappedFile(const std::string& path);
+        ~MappedFile();
+
+        const unsigned char* data() const { return this->bytes; }
+        size_t size() const { return this->length; }
+
+    private:
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#endif
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+};
+
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+{
+    this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (this->file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0)
+        return;
+
+    this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!this->mapping)
+        return;
+
+    this->bytes = (const unsigned char*)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (this->bytes)
+        this->length = (size_t)fileSize.QuadPart;
+}
+
+
+MappedFile::~MappedFile()
+{
+    if (this->bytes)
+        UnmapViewOfFile(this->bytes);
+    if (this->mapping)
+        CloseHandle(this->mapping);
+    if (this->file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->file);
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* mapped = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped != MAP_FAILED)
+        {
+            this->bytes = (const unsigned char*)mapped;
+            this->length = (size_t)fileStat.st_size;
+        }
+    }
+
+    close(file);        // the mapping keeps the file alive
+}
+
+
+MappedFile::~MappedFile()
+{
+    if (this->bytes)
+        munmap((void*)this->bytes, this->length);
+}
+#endif
+
+
+struct RadianceHeader
+{
+    GLuint width = 0;
+    GLuint height = 0;
+    size_t dataOffset = 0;
+};
+
+
+static bool readLine(const unsigned char* bytes, size_t size, size_t& position, std::string& line)
+{
+    if (position >= size)
+        return false;
+
+    const unsigned char* end = (const unsigned char*)std::memchr(bytes + position, '\n', size - position);
+    size_t lineEnd = end ? (size_t)(end - bytes) : size;
+
+    line.assign((const char*)bytes + position, lineEnd - position);
+    position = lineEnd + 1;
+    return end != nullptr;
+}
+
+
+static bool parseHeader(const unsigned char* bytes, size_t size, RadianceHeader& header)
+{
+    size_t position = 0;
+    std::string line;
+
+    if (!readLine(bytes, size, position, line) || (line != "#?RADIANCE" && line != "#?RGBE"))
+        return false;
+
+    // variables up to an empty line, only the pixel format matters
+    bool validFormat = false;
+    while (readLine(bytes, size, position, line) && !line.empty())
+    {
+        if (line == "FORMAT=32-bit_rle_rgbe")
+            validFormat = true;
+    }
+
+    int width = 0, height = 0;
+    if (!validFormat || !readLine(bytes, size, position, line) || std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2)
+        return false;
+    if (width <= 0 || height <= 0)
+        return false;
+
+    header.width = width;
+    header.height = height;
+    header.dataOffset = position;
+    return true;
+}
+
+
+// stbi__hdr_convert: mantissa * 2^(exponent - 128 - 8)
+static inline void rgbeToFloat(unsigned char red, unsigned char green, unsigned char blue, unsigned char exponent, float* rgb)
+{
+    if (exponent == 0)
+    {
+        rgb[0] = rgb[1] = rgb[2] = 0.0f;
+        return;
+    }
+
+    float scale = std::ldexp(1.0f, exponent - (128 + 8));
+    rgb[0] = red * scale;
+    rgb[1] = green * scale;
+    rgb[2] = blue * scale;
+}
+
+
+#ifdef RADIANCEHDR_SSE2
+// 4 texels, one channel per register as 32 bits integers. The scale is built from its exponent bits, which covers every
+// exponent from 10 up (2^-126 and above), the denormal scales of exponents 1 to 9 are redone by the scalar code
+// Writes 4 floats past the 12 it fills (the 4th lane of the last texel)
+static inline bool rgbeToFloat4(__m128i red, __m128i green, __m128i blue, __m128i exponent, float* rgb)
+{
+    __m128i belowNormal = _mm_cmplt_epi32(exponent, _mm_set1_epi32(10));
+    __m128 scale = _mm_castsi128_ps(_mm_andnot_si128(belowNormal, _mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(136 - 127)), 23)));
+
+    __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(red), scale);
+    __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(green), scale);
+    __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(blue), scale);
+    __m128 unused = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r, g, b, unused);
+
+    _mm_storeu_ps(rgb + 0, r);
+    _mm_storeu_ps(rgb + 3, g);
+    _mm_storeu_ps(rgb + 6, b);
+    _mm_storeu_ps(rgb + 9, unused);
+
+    __m128i denormal = _mm_andnot_si128(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()), belowNormal);
+    return _mm_movemask_ps(_mm_castsi128_ps(denormal)) == 0;
+}
+#endif
+
+
+// RLE scanlines are stored channel by channel
+static void convertPlanes(const unsigned char* planes, GLuint width, float* rgb)
+{
+    const unsigned char* red = planes;
+    const unsigned char* green = planes + width;
+    const unsigned char* blue = planes + width * 2;
+    const unsigned char* exponent = planes + width * 3;
+    GLuint x = 0;
+
+#ifdef RADIANCEHDR_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    auto load4 = [&zero](const unsigned char* bytes)
+    {
+        int32_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero), zero);
+    };
+
+    // stops one texel early, the last store spills into the next texel
+    for (; x + 5 <= width; x += 4)
+    {
+        if (!rgbeToFloat4(load4(red + x), load4(green + x), load4(blue + x), load4(exponent + x), rgb + x * 3))
+            for (GLuint i = x; i < x + 4; i++)
+                rgbeToFloat(red[i], green[i], blue[i], exponent[i], rgb + i * 3);
+    }
+#endif
+
+    for (; x < width; x++)
+        rgbeToFloat(red[x], green[x], blue[x], exponent[x], rgb + x * 3);
+}
+
+
+// Flat scanlines (narrow images or files written without RLE) are plain RGBE texels
+static void convertTexels(const unsigned char* rgbe, GLuint width, float* rgb)
+{
+    GLuint x = 0;
+
+#ifdef RADIANCEHDR_SSE2
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+
+    for (; x + 5 <= width; x += 4)
+    {
+        __m128i texels = _mm_loadu_si128((const __m128i*)(rgbe + x * 4));
+        __m128i red = _mm_and_si128(texels, byteMask);
+        __m128i green = _mm_and_si128(_mm_srli_epi32(texels, 8), byteMask);
+        __m128i blue = _mm_and_si128(_mm_srli_epi32(texels, 16), byteMask);
+        __m128i exponent = _mm_srli_epi32(texels, 24);
+
+        if (!rgbeToFloat4(red, green, blue, exponent, rgb + x * 3))
+            for (GLuint i = x; i < x + 4; i++)
+                rgbeToFloat(rgbe[i * 4], rgbe[i * 4 + 1], rgbe[i * 4 + 2], rgbe[i * 4 + 3], rgb + i * 3);
+    }
+#endif
+
+    for (; x < width; x++)
+        rgbeToFloat(rgbe[x * 4], rgbe[x * 4 + 1], rgbe[x * 4 + 2], rgbe[x * 4 + 3], rgb + x * 3);
+}
+
+
+// First pass, sequential: where each RLE scanline starts. The runs are only skipped, and validated,
+// so the parallel pass can decode without bounds checks
+static bool indexScanlines(const unsigned char* bytes, size_t size, const RadianceHeader& header, std::vector<size_t>& offsets)
+{
+    size_t position = header.dataOffset;
+    offsets.resize(header.height);
+
+    for (GLuint y = 0; y < header.height; y++)
+    {
+        if (position + 4 > size || bytes[position] != 2 || bytes[position + 1] != 2 || ((GLuint)bytes[position + 2] << 8 | bytes[position + 3]) != header.width)
+            return false;
+
+        offsets[y] = position;
+        position += 4;
+
+        for (int channel = 0; channel < 4; channel++)
+        {
+            GLuint x = 0;
+            while (x < header.width)
+            {
+                if (position >= size)
+                    return false;
+
+                GLuint count = bytes[position++];
+                if (count > 128)
+                {
+                    count -= 128;
+                    position++;
+                }
+                else
+                {
+                    if (count == 0)
+                        return false;
+                    position += count;
+                }
+
+                if (x + count > header.width || position > size)
+                    return false;
+                x += count;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static void decodeRLEScanline(const unsigned char* bytes, size_t offset, GLuint width, unsigned char* planes)
+{
+    size_t position = offset + 4;
+
+    for (int channel = 0; channel < 4; channel++)
+    {
+        unsigned char* plane = planes + channel * width;
+        GLuint x = 0;
+
+        while (x < width)
+        {
+            GLuint count = bytes[position++];
+            if (count > 128)
+            {
+                count -= 128;
+                std::memset(plane + x, bytes[position++], count);
+            }
+            else
+            {
+                std::memcpy(plane + x, bytes + position, count);
+                position += count;
+            }
+            x += count;
+        }
+    }
+}
+
+
+bool isRadianceHDR(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+
+    return std::getline(file, line) && (line == "#?RADIANCE" || line == "#?RGBE");
+}
+
+
+bool decodeRadianceHDR(const std::string& path, bool flip, GLuint reduction, HDRImageData& image)
+{
+    image.path = path;
+
+    MappedFile file(path);
+    if (!file.data())
+        return false;
+
+    const unsigned char* bytes = file.data();
+    RadianceHeader header;
+    if (!parseHeader(bytes, file.size(), header))
+        return false;
+
+    // Images 8 to 32767 wide are usually RLE encoded, a scanline that does not start with the RLE marker means the
+    // whole image is stored flat (stb_image makes the same call on the first scanline)
+    const unsigned char* data = bytes + header.dataOffset;
+    bool rle = header.width >= 8 && header.width < 32768 && header.dataOffset + 4 <= file.size() &&
+               data[0] == 2 && data[1] == 2 && !(data[2] & 0x80);
+
+    std::vector<size_t> offsets;
+    if (rle && !indexScanlines(bytes, file.size(), header, offsets))
+        return false;
+    if (!rle && header.dataOffset + (size_t)header.width * header.height * 4 > file.size())
+        return false;
+
+    reduction = std::clamp(reduction, 1u, std::min(header.width, header.height));
+    GLuint width = header.width / reduction;
+    GLuint height = header.height / reduction;
+
+    image.width = width;
+    image.height = height;
+    image.components = 3;
+    image.pixels.resize((size_t)width * height * 3);
+
+    GLuint jobCount = (height + decodeRowsPerJob - 1) / decodeRowsPerJob;
+
+    ThreadPool::shared().parallelFor(jobCount, [&](unsigned int job)
+    {
+        std::vector<unsigned char> planes(rle ? header.width * 4 : 0);
+        std::vector<float> scanline(reduction > 1 ? header.width * 3 : 0);
+        std::vector<float> sums(reduction > 1 ? width * 3 : 0);
+
+        auto decodeScanline = [&](GLuint y, float* rgb)
+        {
+            if (rle)
+            {
+                decodeRLEScanline(bytes, offsets[y], header.width, planes.data());
+                convertPlanes(planes.data(), header.width, rgb);
+            }
+            else
+                convertTexels(data + (size_t)y * header.width * 4, header.width, rgb);
+        };
+
+        for (GLuint row = job * decodeRowsPerJob; row < std::min((job + 1) * decodeRowsPerJob, height); row++)
+        {
+            float* destination = image.pixels.data() + (size_t)(flip ? height - 1 - row : row) * width * 3;
+
+            if (reduction == 1)
+            {
+                decodeScanline(row, destination);
+                continue;
+            }
+
+            // preview: box filter of reduction x reduction texels
+            std::fill(sums.begin(), sums.end(), 0.0f);
+            for (GLuint i = 0; i < reduction; i++)
+            {
+                decodeScanline(row * reduction + i, scanline.data());
+                for (GLuint x = 0; x < width; x++)
+                    for (GLuint k = 0; k < reduction; k++)
+                        for (int c = 0; c < 3; c++)
+                            sums[x * 3 + c] += scanline[((size_t)x * reduction + k) * 3 + c];
+            }
+
+            float weight = 1.0f / (reduction * reduction);
+            for (GLuint i = 0; i < width * 3; i++)
+                destination[i] = sums[i] * weight;
+        }
+    });
+
+    return true;
+}
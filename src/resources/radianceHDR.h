@@ -0,0 +1,24 @@
+#ifndef RADIANCEHDR_H
+#define RADIANCEHDR_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+#include "image.h"
+
+
+// Radiance .hdr (RGBE) reader, replaces stbi_loadf for the environment maps
+// The file is memory mapped, a first pass finds where each RLE scanline starts, then the scanlines are decoded
+// in parallel on the shared thread pool and converted to floats 4 texels at a time (SSE2).
+// The floats are bit identical to stbi_loadf: mantissa * 2^(exponent - 136), 0 when the exponent is 0.
+// Only the usual "-Y height +X width" orientation is supported, as in stb_image.
+
+bool isRadianceHDR(const std::string& path);
+
+// rgb floats, flipped so the first row is the bottom of the image when flip is set.
+// reduction > 1 box filters reduction x reduction texels into one while decoding (preview), the partial texels
+// at the right and top edges are dropped
+bool decodeRadianceHDR(const std::string& path, bool flip, GLuint reduction, HDRImageData& image);
+
+#endif
@@ -0,0 +1,200 @@
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "renderTargetPool.h"
+
+
+// approximate, drivers usually pad 3 channels formats to 4
+static size_t getBytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+        case GL_RED: case GL_R8:
+            return 1;
+        case GL_RG8: case GL_R16F:
+            return 2;
+        case GL_RGB: case GL_RGBA: case GL_RGBA8: case GL_RG16: case GL_RG16F: case GL_R32F: case GL_R11F_G11F_B10F: case GL_RGB9_E5:
+        case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F: case GL_RGBA16F: case GL_RG32F:
+            return 8;
+        case GL_RGB32F: case GL_RGBA32F:
+            return 16;
+    }
+
+    return 4;
+}
+
+
+size_t RenderTargetDesc::getSizeInBytes() const
+{
+    size_t size = 0;
+    for (GLuint level = 0; level < levels; level++)
+        size += (size_t)std::max(width >> level, 1u) * std::max(height >> level, 1u) * getBytesPerPixel(internalFormat);
+
+    return size;
+}
+
+
+RenderTargetPool& RenderTargetPool::instance()
+{
+    static RenderTargetPool pool;
+    return pool;
+}
+
+
+GLuint RenderTargetPool::acquireTexture(const RenderTargetDesc& desc)
+{
+    GLuint texture = takeFree(desc);
+
+    if (!texture)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (GLuint level = 0; level < desc.levels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, desc.internalFormat, std::max(desc.width >> level, 1u), std::max(desc.height >> level, 1u), 0, desc.format, desc.type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, desc.levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter == GL_NEAREST || desc.filter == GL_NEAREST_MIPMAP_NEAREST ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);    // screen space lookups must not wrap to the opposite edge
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    this->liveTextures[texture] = desc;
+    this->liveBytes += desc.getSizeInBytes();
+
+    return texture;
+}
+
+
+GLuint RenderTargetPool::acquireRenderbuffer(GLuint width, GLuint height, GLenum internalFormat)
+{
+    RenderTargetDesc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.internalFormat = internalFormat;
+    desc.renderbuffer = true;
+
+    GLuint renderbuffer = takeFree(desc);
+
+    if (!renderbuffer)
+    {
+        glGenRenderbuffers(1, &renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    this->liveRenderbuffers[renderbuffer] = desc;
+    this->liveBytes += desc.getSizeInBytes();
+
+    return renderbuffer;
+}
+
+
+void RenderTargetPool::releaseTexture(GLuint& texture)
+{
+    release(this->liveTextures, texture);
+}
+
+
+void RenderTargetPool::releaseRenderbuffer(GLuint& renderbuffer)
+{
+    release(this->liveRenderbuffers, renderbuffer);
+}
+
+
+void RenderTargetPool::release(std::map<GLuint, RenderTargetDesc>& live, GLuint& target)
+{
+    auto it = live.find(target);
+
+    if (it != live.end())
+    {
+        size_t size = it->second.getSizeInBytes();
+        this->liveBytes -= size;
+        this->pooledBytes += size;
+        this->freeTargets[it->second].push_back({ target, 0 });
+        live.erase(it);
+    }
+
+    target = 0;
+}
+
+
+void RenderTargetPool::endFrame()
+{
+    for (auto it = this->freeTargets.begin(); it != this->freeTargets.end(); )
+    {
+        std::vector<PooledTarget>& targets = it->second;
+
+        for (size_t i = 0; i < targets.size(); )
+        {
+            if (++targets[i].idleFrames > this->maxIdleFrames)
+            {
+                destroy(it->first, targets[i].id);
+                targets.erase(targets.begin() + i);
+            }
+            else
+                i++;
+        }
+
+        it = targets.empty() ? this->freeTargets.erase(it) : std::next(it);
+    }
+}
+
+
+void RenderTargetPool::clear()
+{
+    for (auto& entry : this->freeTargets)
+        for (auto& target : entry.second)
+            destroy(entry.first, target.id);
+
+    this->freeTargets.clear();
+}
+
+
+unsigned int RenderTargetPool::getLiveCount()
+{
+    return (unsigned int)(this->liveTextures.size() + this->liveRenderbuffers.size());
+}
+
+
+size_t RenderTargetPool::getLiveBytes()
+{
+    return this->liveBytes;
+}
+
+
+size_t RenderTargetPool::getPooledBytes()
+{
+    return this->pooledBytes;
+}
+
+
+GLuint RenderTargetPool::takeFree(const RenderTargetDesc& desc)
+{
+    auto it = this->freeTargets.find(desc);
+    if (it == this->freeTargets.end() || it->second.empty())
+        return 0;
+
+    GLuint id = it->second.back().id;
+    it->second.pop_back();
+    this->pooledBytes -= desc.getSizeInBytes();
+
+    return id;
+}
+
+
+void RenderTargetPool::destroy(const RenderTargetDesc& desc, GLuint id)
+{
+    this->pooledBytes -= desc.getSizeInBytes();
+
+    if (desc.renderbuffer)
+        glDeleteRenderbuffers(1, &id);
+    else
+        glDeleteTextures(1, &id);
+}
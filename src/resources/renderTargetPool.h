@@ -0,0 +1,81 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+
+// Size and format of a render target texture or renderbuffer
+struct RenderTargetDesc
+{
+    GLuint width = 0;
+    GLuint height = 0;
+    GLenum internalFormat = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    GLenum filter = GL_NEAREST;
+    GLuint levels = 1;
+    bool renderbuffer = false;
+
+    RenderTargetDesc() {}
+    RenderTargetDesc(GLuint width, GLuint height, GLenum internalFormat, GLenum format, GLenum type, GLenum filter = GL_NEAREST, GLuint levels = 1)
+        : width(width), height(height), internalFormat(internalFormat), format(format), type(type), filter(filter), levels(levels) {}
+
+    bool operator<(const RenderTargetDesc& other) const
+    {
+        return std::tie(width, height, internalFormat, format, type, filter, levels, renderbuffer)
+             < std::tie(other.width, other.height, other.internalFormat, other.format, other.type, other.filter, other.levels, other.renderbuffer);
+    }
+
+    size_t getSizeInBytes() const;
+};
+
+
+// Pool of the render target attachments (textures and renderbuffers), keyed by size and format
+// Released targets are kept for a few frames so a pass that asks for the same target again reuses it,
+// then deleted: resizing the viewport frees the attachments of the previous size instead of leaking them
+class RenderTargetPool
+{
+    public:
+        GLuint maxIdleFrames = 3;
+
+        static RenderTargetPool& instance();
+
+        GLuint acquireTexture(const RenderTargetDesc& desc);
+        GLuint acquireRenderbuffer(GLuint width, GLuint height, GLenum internalFormat);
+        void releaseTexture(GLuint& texture);               // back to the pool and set to 0, no-op on 0
+        void releaseRenderbuffer(GLuint& renderbuffer);
+        void endFrame();                        // ages the released targets and deletes the stale ones
+        void clear();                           // deletes every released target
+
+        unsigned int getLiveCount();
+        size_t getLiveBytes();
+        size_t getPooledBytes();
+
+    private:
+        struct PooledTarget
+        {
+            GLuint id;
+            unsigned int idleFrames;
+        };
+
+        std::map<GLuint, RenderTargetDesc> liveTextures;
+        std::map<GLuint, RenderTargetDesc> liveRenderbuffers;
+        std::map<RenderTargetDesc, std::vector<PooledTarget>> freeTargets;
+        size_t liveBytes = 0;
+        size_t pooledBytes = 0;
+
+        RenderTargetPool() {}
+        RenderTargetPool(const RenderTargetPool&) = delete;
+        RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+        GLuint takeFree(const RenderTargetDesc& desc);
+        void release(std::map<GLuint, RenderTargetDesc>& live, GLuint& target);
+        void destroy(const RenderTargetDesc& desc, GLuint id);
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define SPHERICALHARMONICS_SSE2
+#endif
+
+#include <glad/glad.h>
+
+#include <components/threadpool.h>
+
+#include "sphericalHarmonics.h"
+
+
+// Sums of radiance * basis polynomial, the basis constants are applied once at the end
+typedef std::array<double, 9 * 3> SHSums;
+
+
+static inline void accumulateTexel(float x, float y, float z, const float* rgb, float* sums)
+{
+    const float basis[9] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+
+    for (int k = 0; k < 9; k++)
+    {
+        sums[k * 3 + 0] += basis[k] * rgb[0];
+        sums[k * 3 + 1] += basis[k] * rgb[1];
+        sums[k * 3 + 2] += basis[k] * rgb[2];
+    }
+}
+
+
+// One scanline: the polar angle is constant along it, so only the azimuth tables vary per texel
+static void accumulateRow(const float* red, const float* green, const float* blue, const float* sinTheta, const float* cosTheta,
+                          GLuint width, float sinPhi, float y, float* sums)
+{
+    GLuint x = 0;
+
+#ifdef SPHERICALHARMONICS_SSE2
+    __m128 accumulators[9 * 3];
+    for (auto& accumulator : accumulators)
+        accumulator = _mm_setzero_ps();
+
+    const __m128 sinPhi4 = _mm_set1_ps(sinPhi);
+    const __m128 y4 = _mm_set1_ps(y);
+    const __m128 yy4 = _mm_mul_ps(y4, y4);
+    const __m128 one4 = _mm_set1_ps(1.0f);
+    const __m128 three4 = _mm_set1_ps(3.0f);
+
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128 dirX = _mm_mul_ps(sinPhi4, _mm_loadu_ps(sinTheta + x));
+        __m128 dirZ = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sinPhi4, _mm_loadu_ps(cosTheta + x)));
+        __m128 r = _mm_loadu_ps(red + x);
+        __m128 g = _mm_loadu_ps(green + x);
+        __m128 b = _mm_loadu_ps(blue + x);
+
+        const __m128 basis[9] = {
+            one4, y4, dirZ, dirX,
+            _mm_mul_ps(dirX, y4),
+            _mm_mul_ps(y4, dirZ),
+            _mm_sub_ps(_mm_mul_ps(three4, _mm_mul_ps(dirZ, dirZ)), one4),
+            _mm_mul_ps(dirX, dirZ),
+            _mm_sub_ps(_mm_mul_ps(dirX, dirX), yy4)
+        };
+
+        for (int k = 0; k < 9; k++)
+        {
+            accumulators[k * 3 + 0] = _mm_add_ps(accumulators[k * 3 + 0], _mm_mul_ps(basis[k], r));
+            accumulators[k * 3 + 1] = _mm_add_ps(accumulators[k * 3 + 1], _mm_mul_ps(basis[k], g));
+            accumulators[k * 3 + 2] = _mm_add_ps(accumulators[k * 3 + 2], _mm_mul_ps(basis[k], b));
+        }
+    }
+
+    for (int i = 0; i < 9 * 3; i++)
+    {
+        float lanes[4];
+        _mm_storeu_ps(lanes, accumulators[i]);
+        sums[i] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        const float rgb[3] = { red[x], green[x], blue[x] };
+        accumulateTexel(sinPhi * sinTheta[x], y, -sinPhi * cosTheta[x], rgb, sums);
+    }
+}
+
+
+bool projectIrradianceSH(const float* pixels, GLuint width, GLuint height, GLuint components, IrradianceSH& sh)
+{
+    if (!pixels || width == 0 || height == 0 || components < 3)
+        return false;
+
+    const double pi = 3.14159265358979;
+
+    // latlongToCube.frag: u = (atan(x, -z) + PI) / 2PI, v = acos(-y) / PI
+    std::vector<float> sinTheta(width), cosTheta(width);
+    for (GLuint x = 0; x < width; x++)
+    {
+        double theta = (x + 0.5) / width * 2.0 * pi - pi;
+        sinTheta[x] = (float)std::sin(theta);
+        cosTheta[x] = (float)std::cos(theta);
+    }
+
+    const GLuint tileRows = 16;
+    GLuint tileCount = (height + tileRows - 1) / tileRows;
+    std::vector<SHSums> tileSums(tileCount);
+
+    ThreadPool::shared().parallelFor(tileCount, [&](unsigned int tile)
+    {
+        std::vector<float> red(width), green(width), blue(width);
+        SHSums& total = tileSums[tile];
+        total.fill(0.0);
+
+        for (GLuint row = tile * tileRows; row < std::min((tile + 1) * tileRows, height); row++)
+        {
+            const float* source = pixels + (size_t)row * width * components;
+            for (GLuint x = 0; x < width; x++)
+            {
+                red[x] = source[x * components + 0];
+                green[x] = source[x * components + 1];
+                blue[x] = source[x * components + 2];
+            }
+
+            double phi = (row + 0.5) / height * pi;
+            float rowSums[9 * 3] = {};
+            accumulateRow(red.data(), green.data(), blue.data(), sinTheta.data(), cosTheta.data(), width,
+                          (float)std::sin(phi), (float)-std::cos(phi), rowSums);
+
+            // solid angle of the texels of this row
+            double solidAngle = (2.0 * pi / width) * (pi / height) * std::sin(phi);
+            for (int i = 0; i < 9 * 3; i++)
+                total[i] += rowSums[i] * solidAngle;
+        }
+    });
+
+    // tiles are summed in order, the result does not depend on the thread count
+    SHSums sums = {};
+    for (auto& total : tileSums)
+    {
+        for (int i = 0; i < 9 * 3; i++)
+            sums[i] += total[i];
+    }
+
+    // projection and evaluation both use the basis constant (squared), the cosine lobe scales each band
+    // by PI, 2PI/3 and PI/4 (Ramamoorthi and Hanrahan), the Lambert BRDF divides by PI
+    const double basisConstants[9] = { 0.282095, 0.488603, 0.488603, 0.488603, 1.092548, 1.092548, 0.315392, 1.092548, 0.546274 };
+    const double bandScales[3] = { 1.0, 2.0 / 3.0, 1.0 / 4.0 };
+    const int bands[9] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+    for (int k = 0; k < 9; k++)
+    {
+        double scale = basisConstants[k] * basisConstants[k] * bandScales[bands[k]];
+        for (int c = 0; c < 3; c++)
+            sh.coefficients[k * 3 + c] = (GLfloat)(sums[k * 3 + c] * scale);
+    }
+
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef SPHERICALHARMONICS_H
+#define SPHERICALHARMONICS_H
+
+#include <glad/glad.h>
+
+
+// Diffuse irradiance of an environment as 9 RGB coefficients (L2 spherical harmonics), rgb interleaved per basis.
+// The cosine lobe convolution, the basis constants and the 1/PI of the Lambert BRDF are already folded in,
+// so the lighting shader only evaluates the quadratic polynomial of the world space normal:
+// c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+struct IrradianceSH
+{
+    GLfloat coefficients[9 * 3] = {};
+};
+
+
+// Projects a latlong HDR image (float rgb or rgba, first row at the bottom as uploaded to GL) with the mapping
+// used by latlongToCube.frag. Scanlines are spread over the shared thread pool, 4 texels at a time with SSE.
+bool projectIrradianceSH(const float* pixels, GLuint width, GLuint height, GLuint components, IrradianceSH& sh);
+
+#endif
@@ -2,11 +2,15 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <utility>
 
 #include <glad/glad.h>
 
 #include "stb_image.h"
 #include "texture.h"
+#include "image.h"
+#include "hdrPack.h"
 
 
 Texture::Texture()
@@ -23,47 +27,45 @@ Texture::~Texture()
 
 void Texture::setTexture(const char* texPath, std::string texName, bool texFlip)
 {
+    releaseTexture();       // a texture set again frees its previous one
+
     this->texType = GL_TEXTURE_2D;
 
     std::string tempPath = std::string(texPath);
 
-    if(texFlip)
-        stbi_set_flip_vertically_on_load(true);
-    else
-        stbi_set_flip_vertically_on_load(false);
-
     glGenTextures(1, &this->texID);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, this->texID);
     glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisoFilterLevel);  // Request the maximum level of anisotropy the GPU used can support and use it
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, this->anisoFilterLevel);
 
-    int width, height, numComponents;
-    unsigned char* texData = stbi_load(tempPath.c_str(), &width, &height, &numComponents, 0);
+    ImageData image;
+    bool loaded = loadImageData(tempPath, image);
+
+    if (loaded && texFlip)
+        flipImageVertically(image.pixels.data(), image.width, image.height, image.components);
 
-    this->texWidth = width;
-    this->texHeight = height;
-    this->texComponents = numComponents;
+    this->texWidth = image.width;
+    this->texHeight = image.height;
+    this->texComponents = image.components;
     this->texName = texName;
 
-    if (texData)
+    if (loaded)
     {
-        if (numComponents == 1)
-            this->texFormat = GL_RED;
-        else if (numComponents == 3)
-            this->texFormat = GL_RGB;
-        else if (numComponents == 4)
-            this->texFormat = GL_RGBA;
+        this->texFormat = image.format;
         this->texInternalFormat = this->texFormat;
 
-        glTexImage2D(GL_TEXTURE_2D, 0, this->texInternalFormat, this->texWidth, this->texHeight, 0, this->texFormat, GL_UNSIGNED_BYTE, texData);
+        buildImageMips(image);      // linear space filtering on the CPU instead of glGenerateMipmap
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (GLuint level = 0; level < image.getLevelCount(); level++)
+            glTexImage2D(GL_TEXTURE_2D, level, this->texInternalFormat, image.getLevelWidth(level), image.getLevelHeight(level), 0, this->texFormat, GL_UNSIGNED_BYTE, image.getLevelPixels(level));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);     // Need AF to get ride of the blur on textures
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glGenerateMipmap(GL_TEXTURE_2D);
     }
 
     else
@@ -71,80 +73,90 @@ void Texture::setTexture(const char* texPath, std::string texName, bool texFlip)
         std::cerr << "TEXTURE FAILED - LOADING : " << texPath << std::endl;
     }
 
-    stbi_image_free(texData);
-
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 
-void Texture::setTextureHDR(const char* texPath, std::string texName, bool texFlip)
+void Texture::setTextureHDR(const char* texPath, std::string texName, bool texFlip, GLenum internalFormat)
 {
-    this->texType = GL_TEXTURE_2D;
+    HDRImageData image;
+    loadHDRImageData(texPath, texFlip, image);
 
-    std::string tempPath = std::string(texPath);
+    setTextureHDR(image, texName, internalFormat);
+}
 
-    if(texFlip)
-        stbi_set_flip_vertically_on_load(true);
-    else
-        stbi_set_flip_vertically_on_load(false);
 
-    glGenTextures(1, &this->texID);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->texID);
+void Texture::setTextureHDR(const HDRImageData& image, std::string texName, GLenum internalFormat)
+{
+    IrradianceSH irradiance;
+    if (image.isValid())
+        projectIrradianceSH(image.pixels.data(), image.width, image.height, image.components, irradiance);
 
-    if(stbi_is_hdr(tempPath.c_str()))
-    {
-        int width, height, numComponents;
-        float* texData = stbi_loadf(tempPath.c_str(), &width, &height, &numComponents, 0);
+    setTextureHDR(image, irradiance, texName, internalFormat);
+}
 
-        this->texWidth = width;
-        this->texHeight = height;
-        this->texComponents = numComponents;
-        this->texName = texName;
 
-        if (texData)
-        {
-            // Need a higher precision format for HDR to not lose informations, thus 32bits floating point
-            if (numComponents == 3)
-            {
-                this->texInternalFormat = GL_RGB32F;
-                this->texFormat = GL_RGB;
-            }
-            else if (numComponents == 4)
-            {
-                this->texInternalFormat = GL_RGBA32F;
-                this->texFormat = GL_RGBA;
-            }
+// The projection can run on a worker with the decode, only the packing and the upload happen here
+void Texture::setTextureHDR(const HDRImageData& image, const IrradianceSH& irradiance, std::string texName, GLenum internalFormat)
+{
+    HDRPackedImageData packed;
+    packHDRImage(image, internalFormat, packed);
 
-            glTexImage2D(GL_TEXTURE_2D, 0, this->texInternalFormat, this->texWidth, this->texHeight, 0, this->texFormat, GL_FLOAT, texData);
+    setTextureHDR(packed, irradiance, texName);
+    uploadTextureRows(packed, 0, packed.height);
+}
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
+// Allocates the texture only, uploadTextureRows fills it, all at once or a strip of rows per frame
+void Texture::setTextureHDR(const HDRPackedImageData& image, const IrradianceSH& irradiance, std::string texName)
+{
+    releaseTexture();
 
-        else
-        {
-            std::cerr << "HDR TEXTURE - FAILED LOADING : " << texPath << std::endl;
-        }
+    this->texType = GL_TEXTURE_2D;
 
-        stbi_image_free(texData);
-    }
+    glGenTextures(1, &this->texID);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->texID);
 
-    else
+    this->texWidth = image.width;
+    this->texHeight = image.height;
+    this->texComponents = image.components;
+    this->texName = texName;
+
+    if (image.isValid())
     {
-        std::cerr << "HDR TEXTURE - FILE IS NOT HDR : " << texPath << std::endl;
+        this->texHash = image.hash;
+        this->texIrradianceSH = irradiance;
+        this->texInternalFormat = image.internalFormat;
+        this->texFormat = image.format;
+
+        glTexImage2D(GL_TEXTURE_2D, 0, this->texInternalFormat, this->texWidth, this->texHeight, 0, this->texFormat, image.type, nullptr);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);      // Sampled at its base level only, no mips needed
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 
+void Texture::uploadTextureRows(const HDRPackedImageData& image, GLuint firstRow, GLuint rowCount)
+{
+    if (!image.isValid() || !this->texID)
+        return;
+
+    glBindTexture(GL_TEXTURE_2D, this->texID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, image.width, rowCount, image.format, image.type, image.getRow(firstRow));
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
 void Texture::setTextureHDR(GLuint width, GLuint height, GLenum format, GLenum internalFormat, GLenum type, GLenum minFilter)
 {
+	releaseTexture();
+
 	this->texType = GL_TEXTURE_2D;
 
 	glGenTextures(1, &this->texID);
@@ -165,21 +177,29 @@ void Texture::setTextureHDR(GLuint width, GLuint height, GLenum format, GLenum i
 	else if (format == GL_RGBA)
 		this->texComponents = 4;
 
-	glTexImage2D(GL_TEXTURE_2D, 0, this->texInternalFormat, this->texWidth, this->texHeight, 0, this->texFormat, GL_FLOAT, nullptr);
+	// Render target: the levels are only allocated (when the filter needs them), whatever renders into it fills them
+	GLuint levels = 1;
+	if (minFilter != GL_LINEAR && minFilter != GL_NEAREST)
+		while ((width >> levels) > 0 || (height >> levels) > 0)
+			levels++;
+
+	for (GLuint level = 0; level < levels; level++)
+		glTexImage2D(GL_TEXTURE_2D, level, this->texInternalFormat, std::max(width >> level, 1u), std::max(height >> level, 1u), 0, this->texFormat, type, nullptr);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	glGenerateMipmap(GL_TEXTURE_2D);
-
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 
 void Texture::setTextureCube(std::vector<const char*>& faces, bool texFlip)
 {
+    releaseTexture();
+
     this->texType = GL_TEXTURE_CUBE_MAP;
 
     std::vector<std::string> cubemapFaces;
@@ -190,11 +210,6 @@ void Texture::setTextureCube(std::vector<const char*>& faces, bool texFlip)
         cubemapFaces.push_back(tempPath);
     }
 
-    if(texFlip)
-        stbi_set_flip_vertically_on_load(true);
-    else
-        stbi_set_flip_vertically_on_load(false);
-
     glGenTextures(1, &this->texID);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(this->texType, this->texID);
@@ -206,7 +221,10 @@ void Texture::setTextureCube(std::vector<const char*>& faces, bool texFlip)
     {
         texData = stbi_load(cubemapFaces[i].c_str(), &width, &height, &numComponents, 0);
 
-        if(this->texWidth == NULL && this->texHeight == NULL && this->texComponents == NULL)
+        if (texData && texFlip)
+            flipImageVertically(texData, width, height, numComponents);
+
+        if(this->texWidth == 0 && this->texHeight == 0 && this->texComponents == 0)
         {
             this->texWidth = width;
             this->texHeight = height;
@@ -253,6 +271,8 @@ void Texture::setTextureCube(std::vector<const char*>& faces, bool texFlip)
 
 void Texture::setTextureCube(GLuint width, GLenum format, GLenum internalFormat, GLenum type, GLenum minFilter)
 {
+    releaseTexture();
+
     this->texType = GL_TEXTURE_CUBE_MAP;
 
     glGenTextures(1, &this->texID);
@@ -261,7 +281,7 @@ void Texture::setTextureCube(GLuint width, GLenum format, GLenum internalFormat,
 
     for(GLuint i = 0; i < 6; ++i)
     {
-        if(this->texWidth == NULL && this->texHeight == NULL && this->texComponents == NULL)
+        if(this->texWidth == 0 && this->texHeight == 0 && this->texComponents == 0)
         {
             this->texWidth = width;
             this->texHeight = width;
@@ -296,6 +316,33 @@ void Texture::computeTexMipmap()
 }
 
 
+// Exchanges the GL textures and their description, a texture can be filled in the background and then take the place of another
+void Texture::swapTexture(Texture& other)
+{
+    std::swap(this->texID, other.texID);
+    std::swap(this->texWidth, other.texWidth);
+    std::swap(this->texHeight, other.texHeight);
+    std::swap(this->texComponents, other.texComponents);
+    std::swap(this->anisoFilterLevel, other.anisoFilterLevel);
+    std::swap(this->texType, other.texType);
+    std::swap(this->texInternalFormat, other.texInternalFormat);
+    std::swap(this->texFormat, other.texFormat);
+    std::swap(this->texName, other.texName);
+    std::swap(this->texHash, other.texHash);
+    std::swap(this->texIrradianceSH, other.texIrradianceSH);
+}
+
+
+void Texture::releaseTexture()
+{
+    glDeleteTextures(1, &this->texID);
+    this->texID = 0;
+    this->texWidth = 0;         // the cubemap setters only take the size of an empty texture
+    this->texHeight = 0;
+    this->texComponents = 0;
+}
+
+
 GLuint Texture::getTexID()
 {
     return this->texID;
@@ -314,6 +361,18 @@ GLuint Texture::getTexHeight()
 }
 
 
+uint64_t Texture::getTexHash()
+{
+    return this->texHash;
+}
+
+
+const IrradianceSH& Texture::getTexIrradianceSH()
+{
+    return this->texIrradianceSH;
+}
+
+
 std::string Texture::getTexName()
 {
     return this->texName;
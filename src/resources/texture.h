@@ -6,30 +6,45 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <cstdint>
 
 #include <glad/glad.h>
 
+#include "image.h"
+#include "hdrPack.h"
+#include "sphericalHarmonics.h"
+
 
 class Texture
 {
     public:
-        GLuint texID, texWidth, texHeight, texComponents;
+        GLuint texID = 0, texWidth = 0, texHeight = 0, texComponents = 0;     // 0 until set, the setters release a previous texture
         GLfloat anisoFilterLevel;
         GLenum texType, texInternalFormat, texFormat;
         std::string texName;
+        uint64_t texHash = 0;           // content hash of the loaded file data, 0 for render targets
+        IrradianceSH texIrradianceSH;   // diffuse irradiance of a latlong HDR environment, projected at load
 
         Texture();
         ~Texture();
         void setTexture(const char* texPath, std::string texName, bool texFlip);
-        void setTextureHDR(const char* texPath, std::string texName, bool texFlip);
+        void setTextureHDR(const char* texPath, std::string texName, bool texFlip, GLenum internalFormat = GL_RGB32F);
+        void setTextureHDR(const HDRImageData& image, std::string texName, GLenum internalFormat);     // GL_RGB32F, GL_RGBA16F or GL_RGB9_E5
+        void setTextureHDR(const HDRImageData& image, const IrradianceSH& irradiance, std::string texName, GLenum internalFormat);  // SH already projected
+        void setTextureHDR(const HDRPackedImageData& image, const IrradianceSH& irradiance, std::string texName);         // storage only, see uploadTextureRows
+        void uploadTextureRows(const HDRPackedImageData& image, GLuint firstRow, GLuint rowCount);
 		void setTextureHDR(GLuint width, GLuint height, GLenum format, GLenum internalFormat, GLenum type, GLenum minFilter);
         void setTextureCube(std::vector<const char*>& faces, bool texFlip);
         void setTextureCube(GLuint width, GLenum format, GLenum internalFormat, GLenum type, GLenum minFilter);
         void computeTexMipmap();
+        void swapTexture(Texture& other);
+        void releaseTexture();
         GLuint getTexID();
         GLuint getTexWidth();
         GLuint getTexHeight();
         std::string getTexName();
+        uint64_t getTexHash();
+        const IrradianceSH& getTexIrradianceSH();
         void useTexture();
 };
 
@@ -0,0 +1,233 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <filesystem>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "image.h"
+#include "textureCache.h"
+#include "textureStreamer.h"
+#include "textureCooker.h"
+
+
+// handles can go away on any thread and after the context is gone (static models), so no GL call here,
+// the name is 0 once TextureCache::release has deleted it
+CachedTexture::~CachedTexture()
+{
+    if (this->id == 0)
+        return;
+
+    TextureCache& cache = TextureCache::instance();
+    std::lock_guard<std::mutex> lock(cache.unusedMutex);
+    cache.unusedTextures.push_back(this->id);
+}
+
+
+TextureCache& TextureCache::instance()
+{
+    static TextureCache cache;
+    return cache;
+}
+
+
+std::string TextureCache::canonicalPath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+
+    if (error)
+        return path;
+
+    return canonical.generic_string();
+}
+
+
+// the same file cooked for two usages are two different textures
+std::string TextureCache::getKey(const std::string& path, TextureUsage usage)
+{
+    return getCookedPath(canonicalPath(path), usage, this->highQuality && usage == TextureUsage::Color, this->compression);
+}
+
+
+TextureHandle TextureCache::find(const std::string& path, TextureUsage usage)
+{
+    std::string key = getKey(path, usage);
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+
+    auto it = this->texturesByPath.find(key);
+    if (it == this->texturesByPath.end())
+        return nullptr;
+
+    TextureHandle texture = it->second.lock();
+    if (!texture)
+        this->texturesByPath.erase(it);
+
+    return texture;
+}
+
+
+std::shared_ptr<ImageData> TextureCache::decode(const std::string& path, TextureUsage usage)
+{
+    std::string key = getKey(path, usage);
+    std::promise<std::shared_ptr<ImageData>> promise;
+    std::unique_lock<std::mutex> lock(this->cacheMutex);
+
+    auto decoded = this->decodedImages.find(key);
+    if (decoded != this->decodedImages.end())
+    {
+        if (std::shared_ptr<ImageData> image = decoded->second.lock())
+            return image;
+        this->decodedImages.erase(decoded);
+    }
+
+    auto pending = this->pendingDecodes.find(key);
+    if (pending != this->pendingDecodes.end())
+    {
+        std::shared_future<std::shared_ptr<ImageData>> result = pending->second;
+        lock.unlock();
+        return result.get();        // another worker is already decoding this file
+    }
+
+    this->pendingDecodes[key] = promise.get_future().share();
+    lock.unlock();
+
+    std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+    // the whole chain is built (or read back) here so the render thread only copies
+    if (!cookTexture(canonicalPath(path), usage, *image, this->highQuality && usage == TextureUsage::Color, this->compression))
+        image->pixels.clear();
+    image->path = key;
+
+    lock.lock();
+    this->pendingDecodes.erase(key);
+    this->decodedImages[key] = image;
+    lock.unlock();
+
+    promise.set_value(image);
+
+    return image;
+}
+
+
+TextureHandle TextureCache::acquire(const std::shared_ptr<ImageData>& imagePtr)
+{
+    if (!imagePtr || !imagePtr->isValid())
+        return nullptr;
+
+    const ImageData& image = *imagePtr;
+
+    {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+
+        auto byPath = this->texturesByPath.find(image.path);
+        if (byPath != this->texturesByPath.end())
+        {
+            if (TextureHandle texture = byPath->second.lock())
+                return texture;
+        }
+
+        auto byHash = this->texturesByHash.find(image.hash);
+        if (byHash != this->texturesByHash.end())
+        {
+            if (TextureHandle texture = byHash->second.lock())
+            {
+                this->texturesByPath[image.path] = texture;     // same pixels under another name
+                return texture;
+            }
+        }
+    }
+
+    TextureHandle texture = std::make_shared<CachedTexture>();
+    glGenTextures(1, &texture->id);
+    texture->path = image.path;
+    texture->hash = image.hash;
+    texture->sizeInBytes = image.levelOffsets.empty() ? image.pixels.size() * 4 / 3 : image.pixels.size();
+
+    TextureStreamer::instance().allocate(texture, imagePtr);
+
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+    this->texturesByPath[image.path] = texture;
+    this->texturesByHash[image.hash] = texture;
+
+    return texture;
+}
+
+
+TextureHandle TextureCache::load(const std::string& path, TextureUsage usage)
+{
+    if (TextureHandle texture = find(path, usage))
+        return texture;
+
+    return acquire(decode(path, usage));
+}
+
+
+void TextureCache::collect()
+{
+    std::vector<GLuint> textures;
+    {
+        std::lock_guard<std::mutex> lock(this->unusedMutex);
+        textures.swap(this->unusedTextures);
+    }
+
+    if (!textures.empty())
+        glDeleteTextures((GLsizei)textures.size(), textures.data());
+}
+
+
+void TextureCache::release()
+{
+    std::vector<GLuint> textures;
+    {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+
+        // handles still held by the models outlive the context, their name is cleared so they delete nothing
+        for (auto& entry : this->texturesByHash)
+        {
+            if (TextureHandle texture = entry.second.lock())
+            {
+                if (texture->id != 0)
+                    textures.push_back(texture->id);
+                texture->id = 0;
+            }
+        }
+
+        this->texturesByPath.clear();
+        this->texturesByHash.clear();
+        this->decodedImages.clear();
+    }
+
+    if (!textures.empty())
+        glDeleteTextures((GLsizei)textures.size(), textures.data());
+
+    collect();
+}
+
+
+unsigned int TextureCache::getTextureCount()
+{
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+
+    unsigned int count = 0;
+    for (auto& texture : this->texturesByHash)
+        if (!texture.second.expired())
+            count++;
+
+    return count;
+}
+
+
+size_t TextureCache::getResidentBytes()
+{
+    std::lock_guard<std::mutex> lock(this->cacheMutex);
+
+    size_t size = 0;
+    for (auto& entry : this->texturesByHash)
+        if (TextureHandle texture = entry.second.lock())
+            size += texture->sizeInBytes;
+
+    return size;
+}
@@ -0,0 +1,75 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "image.h"
+#include "blockCompress.h"
+
+
+// GPU texture owned by the cache, queued for deletion when the last handle goes away,
+// the GL name itself is deleted by TextureCache::collect on the render thread
+struct CachedTexture
+{
+    GLuint id = 0;
+    std::string path;
+    uint64_t hash = 0;
+    size_t sizeInBytes = 0;
+
+    ~CachedTexture();
+};
+
+typedef std::shared_ptr<CachedTexture> TextureHandle;
+
+
+// Process wide texture cache shared by every Model
+// Textures are keyed by canonical path and by content hash, so the same file referenced through different
+// relative paths, or two identical files, end up as a single texture in VRAM
+// The cache only keeps weak references, a texture is freed as soon as no mesh uses it anymore
+// With compression on, images are cooked to block compressed KTX files on first use (see textureCooker.h)
+class TextureCache
+{
+    public:
+        static TextureCache& instance();
+        static std::string canonicalPath(const std::string& path);
+
+        bool compression = true;        // cook the textures to BC formats, plain RGB(A) mips otherwise
+        bool highQuality = false;       // BC7 instead of BC1 / BC3 for the color textures
+
+        TextureHandle find(const std::string& path, TextureUsage usage = TextureUsage::Color);                  // Thread safe, null if the file is not resident
+        std::shared_ptr<ImageData> decode(const std::string& path, TextureUsage usage = TextureUsage::Color);   // Thread safe, a file is only decoded once even when requested concurrently
+        TextureHandle acquire(const std::shared_ptr<ImageData>& image);                                         // Render thread only, streams the image in unless an identical texture is resident
+        TextureHandle load(const std::string& path, TextureUsage usage = TextureUsage::Color);                  // Render thread only, find + decode + acquire
+
+        void collect();                 // Render thread only, once per frame, deletes the textures no mesh uses anymore
+        void release();                 // Render thread only, before the context is destroyed, deletes every texture
+
+        unsigned int getTextureCount();
+        size_t getResidentBytes();
+
+    private:
+        std::mutex cacheMutex;
+        std::unordered_map<std::string, std::weak_ptr<CachedTexture>> texturesByPath;
+        std::unordered_map<uint64_t, std::weak_ptr<CachedTexture>> texturesByHash;
+        std::unordered_map<std::string, std::weak_ptr<ImageData>> decodedImages;
+        std::unordered_map<std::string, std::shared_future<std::shared_ptr<ImageData>>> pendingDecodes;
+        std::mutex unusedMutex;                 // own lock, a handle can go away while cacheMutex is held
+        std::vector<GLuint> unusedTextures;     // names of the textures whose last handle went away
+
+        friend struct CachedTexture;
+
+        std::string getKey(const std::string& path, TextureUsage usage);
+
+        TextureCache() {}
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include <string>
+#include <filesystem>
+#include <iostream>
+
+#include "image.h"
+#include "contentHash.h"
+#include "blockCompress.h"
+#include "ktx.h"
+#include "textureCooker.h"
+
+
+std::string getCookedPath(const std::string& path, TextureUsage usage, bool highQuality, bool compress)
+{
+    const char* usageName = usage == TextureUsage::Normal ? "normal" : usage == TextureUsage::Mask ? "mask" : "color";
+
+    return path + '.' + usageName + (!compress ? "-raw" : highQuality ? "-hq" : "") + ".ktx";
+}
+
+
+bool isCookedUpToDate(const std::string& path, const std::string& cookedPath)
+{
+    std::error_code error;
+
+    if (!std::filesystem::exists(cookedPath, error))
+        return false;
+    if (!std::filesystem::exists(path, error))
+        return true;        // only the cooked file was shipped
+
+    return std::filesystem::last_write_time(cookedPath, error) >= std::filesystem::last_write_time(path, error);
+}
+
+
+bool cookTexture(const std::string& path, TextureUsage usage, ImageData& image, bool highQuality, bool compress)
+{
+    std::string cookedPath = getCookedPath(path, usage, highQuality, compress);
+
+    if (isCookedUpToDate(path, cookedPath) && loadKTX(cookedPath, image))
+        return true;
+
+    // grey + alpha color images are expanded so the alpha keeps linear mips and lands in the alpha channel
+    if (!compress)
+    {
+        if (!loadImageData(path, image))
+            return false;
+        if (usage == TextureUsage::Color)
+            expandGreyAlpha(image);
+        buildImageMips(image, usage);
+
+        // over every level like loadKTX, the source hash would let another usage of the file share this texture
+        image.hash = hashBytes(image.pixels.data(), image.pixels.size(), hashMix(hashMix(image.width, image.height), image.internalFormat));
+    }
+    else
+    {
+        ImageData source;
+        if (!loadImageData(path, source))
+            return false;
+        if (usage == TextureUsage::Color)
+            expandGreyAlpha(source);
+        buildImageMips(source, usage);
+
+        BlockFormat format = chooseBlockFormat(usage, source.components, highQuality);
+        if (!compressImage(source, format, image))
+            return false;
+    }
+
+    // a read only resource folder only costs the cooking time on every run
+    if (!saveKTX(cookedPath, image))
+        std::cerr << "TEXTURE - FAILED WRITING : " << cookedPath << std::endl;
+
+    return true;
+}
@@ -0,0 +1,17 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <string>
+
+#include "image.h"
+#include "blockCompress.h"
+
+
+// Import time cooking: a source image is decoded, mipmapped (see buildImageMips) and block compressed once, the
+// result is stored next to it as <file>.<usage>.ktx and loaded directly on the following runs (until the source changes)
+// Without compression the plain mip chain is cached the same way, as <file>.<usage>-raw.ktx
+std::string getCookedPath(const std::string& path, TextureUsage usage, bool highQuality = false, bool compress = true);
+bool isCookedUpToDate(const std::string& path, const std::string& cookedPath);
+bool cookTexture(const std::string& path, TextureUsage usage, ImageData& image, bool highQuality = false, bool compress = true);    // Thread safe
+
+#endif
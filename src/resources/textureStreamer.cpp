@@ -0,0 +1,239 @@
+#include <memory>
+#include <list>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "image.h"
+#include "textureCache.h"
+#include "textureStreamer.h"
+
+
+TextureStreamer& TextureStreamer::instance()
+{
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+
+// the staging buffers are deleted here rather than in the destructor, which runs after glfwTerminate
+void TextureStreamer::shutdown()
+{
+    for (auto& buffer : this->staging)
+    {
+        if (buffer.fence)
+            glDeleteSync(buffer.fence);
+        glDeleteBuffers(1, &buffer.pbo);
+    }
+
+    this->staging.clear();
+    this->nextStaging = 0;
+    this->jobs.clear();
+}
+
+
+void TextureStreamer::allocate(const TextureHandle& texture, const std::shared_ptr<ImageData>& image)
+{
+    GLuint levels = image->getLevelCount();
+
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);     // RGB and RED rows are not 4 bytes aligned
+
+    // every level is defined up front (the texture is complete), but only the coarse ones get pixels now
+    GLuint baseLevel = levels;
+    for (GLuint level = 0; level < levels; level++)
+    {
+        GLuint width = image->getLevelWidth(level);
+        GLuint height = image->getLevelHeight(level);
+        bool resident = width <= residentSize && height <= residentSize;
+
+        if (resident && baseLevel == levels)
+            baseLevel = level;
+
+        const unsigned char* pixels = resident ? image->getLevelPixels(level) : NULL;
+        if (image->isCompressed())
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, image->internalFormat, width, height, 0, (GLsizei)image->getLevelSize(level), pixels);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, image->internalFormat, width, height, 0, image->format, GL_UNSIGNED_BYTE, pixels);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, std::min(baseLevel, levels - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (baseLevel == 0)
+        return;
+
+    StreamJob job;
+    job.texture = texture;
+    job.image = image;
+    job.level = baseLevel - 1;
+    job.row = 0;
+    this->jobs.push_back(job);
+}
+
+
+void TextureStreamer::update(float budgetMs)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start] { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+    while (!this->jobs.empty() && elapsedMs() < budgetMs)
+    {
+        StreamJob& job = this->jobs.front();
+        TextureHandle texture = job.texture.lock();
+
+        if (!texture)
+        {
+            this->jobs.pop_front();     // nobody uses the texture anymore
+            continue;
+        }
+
+        size_t rowSize = job.image->getLevelRowSize(job.level);
+        GLuint levelRows = job.image->getLevelRowCount(job.level);
+        GLuint rowCount = std::min(levelRows - job.row, (GLuint)std::max(stagingSize / rowSize, (size_t)1));
+
+        // a single row larger than a staging buffer never fits the ring, it is sent straight from memory
+        StagingBuffer* buffer = nullptr;
+        if (rowSize <= stagingSize)
+        {
+            buffer = acquireStaging();
+            if (!buffer)
+                break;                  // every staging buffer is still in flight, try again next frame
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+        if (!uploadStrip(job, buffer, rowCount))
+        {
+            glBindTexture(GL_TEXTURE_2D, 0);
+            break;
+        }
+
+        if (job.row == levelRows)
+        {
+            // the level is complete, it can be sampled from now on
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+
+            if (job.level == 0)
+                this->jobs.pop_front();
+            else
+            {
+                job.level--;
+                job.row = 0;
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+
+TextureStreamer::StagingBuffer* TextureStreamer::acquireStaging()
+{
+    if (this->staging.empty())
+    {
+        this->staging.resize(stagingCount);
+        for (auto& buffer : this->staging)
+        {
+            glGenBuffers(1, &buffer.pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingSize, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    StagingBuffer& buffer = this->staging[this->nextStaging];
+
+    if (buffer.fence)
+    {
+        GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return nullptr;
+
+        glDeleteSync(buffer.fence);
+        buffer.fence = 0;
+    }
+
+    this->nextStaging = (this->nextStaging + 1) % stagingCount;
+
+    return &buffer;
+}
+
+
+// without a staging buffer the strip is uploaded synchronously from the image
+bool TextureStreamer::uploadStrip(StreamJob& job, StagingBuffer* buffer, GLuint rowCount)
+{
+    GLuint width = job.image->getLevelWidth(job.level);
+    GLuint rowHeight = job.image->getRowHeight();
+    GLuint y = job.row * rowHeight;
+    GLuint height = std::min(rowCount * rowHeight, job.image->getLevelHeight(job.level) - y);
+    size_t rowSize = job.image->getLevelRowSize(job.level);
+    size_t stripSize = rowSize * rowCount;
+    const unsigned char* strip = job.image->getLevelPixels(job.level) + job.row * rowSize;
+
+    if (buffer)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stripSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+        if (!mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return false;
+        }
+
+        std::memcpy(mapped, strip, stripSize);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        strip = NULL;       // offset 0 in the PBO
+    }
+
+    // the copy from the PBO is asynchronous, the fence tells when the buffer can be written again
+    if (job.image->isCompressed())
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, width, height, job.image->internalFormat, (GLsizei)stripSize, strip);
+    else
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, width, height, job.image->format, GL_UNSIGNED_BYTE, strip);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    if (buffer)
+    {
+        buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    job.row += rowCount;
+
+    return true;
+}
+
+
+unsigned int TextureStreamer::getPendingCount()
+{
+    return (unsigned int)this->jobs.size();
+}
+
+
+size_t TextureStreamer::getPendingBytes()
+{
+    size_t size = 0;
+    for (auto& job : this->jobs)
+    {
+        size += job.image->getLevelSize(job.level) - job.row * job.image->getLevelRowSize(job.level);
+        for (GLuint level = 0; level < job.level; level++)
+            size += job.image->getLevelSize(level);
+    }
+
+    return size;
+}
@@ -0,0 +1,61 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <memory>
+#include <list>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "image.h"
+#include "textureCache.h"
+
+
+// Streams the mip chain of the cached textures to the GPU through a ring of pixel buffer objects
+// The coarse levels are uploaded right away so the texture can be sampled on the next frame, the finer ones
+// follow from the smallest to the largest, GL_TEXTURE_BASE_LEVEL is lowered as each of them lands
+// Staging buffers are only reused once their fence has signaled, so the copies overlap with rendering
+class TextureStreamer
+{
+    public:
+        static const GLuint residentSize = 64;                      // levels up to this size are uploaded synchronously
+        static const size_t stagingSize = 4 * 1024 * 1024;          // bytes per staging buffer, larger levels are sent in strips, larger rows directly
+        static const unsigned int stagingCount = 4;
+
+        static TextureStreamer& instance();
+
+        void allocate(const TextureHandle& texture, const std::shared_ptr<ImageData>& image);     // Render thread only
+        void update(float budgetMs);                                                             // Render thread only, once per frame
+        void shutdown();                                                                         // Render thread only, before the context is destroyed
+
+        unsigned int getPendingCount();
+        size_t getPendingBytes();
+
+    private:
+        struct StreamJob
+        {
+            std::weak_ptr<CachedTexture> texture;
+            std::shared_ptr<ImageData> image;
+            GLuint level;           // level being streamed
+            GLuint row;             // next row of that level
+        };
+
+        struct StagingBuffer
+        {
+            GLuint pbo = 0;
+            GLsync fence = 0;
+        };
+
+        std::list<StreamJob> jobs;
+        std::vector<StagingBuffer> staging;
+        unsigned int nextStaging = 0;
+
+        TextureStreamer() {}
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        StagingBuffer* acquireStaging();
+        bool uploadStrip(StreamJob& job, StagingBuffer* buffer, GLuint rowCount);      // null buffer for rows larger than stagingSize
+};
+
+#endif
@@ -0,0 +1,134 @@
+// Offline IBL baker
+// Bakes the image based lighting of equirectangular .hdr environments on the CPU, into the IBL cache the engine
+// reads at startup (resources/cache/ibl), so machines without a GPU can produce them. Run from the repository root:
+// the cache keys include the bake shaders, exactly as the engine computes them.
+// Also bakes the BRDF LUT asset (resources/textures/ibl) when it is missing, run it without files for the LUT only.
+//
+// usage: bakeIBL [--force] [--cube] [file.hdr]...
+//      --force     bake again even when the cache already holds the products
+//      --cube      also write the mipmapped environment cubemap (<key>.cube.ktx)
+//
+// Prints the time, sample count and error against 4096 samples of every prefiltered mip.
+// Products: the GGX prefiltered cubemap of each environment and the BRDF LUT, as RGB / RG half floats.
+// Diffuse irradiance needs no bake, the engine projects it to spherical harmonics when it loads the .hdr,
+// the coefficients are printed for reference.
+//
+// builds from src/tools/bakeIBL.cpp with src/resources/iblBaker.cpp, iblCache.cpp, sphericalHarmonics.cpp, hdrPack.cpp, ktx.cpp,
+// radianceHDR.cpp, image.cpp, stb_image and glad (no GL context is created)
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <iostream>
+#include <chrono>
+
+#include "image.h"
+#include "iblCache.h"
+#include "iblBaker.h"
+#include "sphericalHarmonics.h"
+
+
+static float getElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int main(int argc, char** argv)
+{
+    bool force = false;
+    bool writeCube = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "--force")
+            force = true;
+        else if (argument == "--cube")
+            writeCube = true;
+        else
+            files.push_back(argument);
+    }
+
+    IBLBakeSettings settings;
+    settings.shaderHash = getIBLShaderHash(getIBLBakeShaders());
+
+    int failed = 0;
+
+    // BRDF LUT, shared by every environment
+    std::string lutPath = getBRDFLUTPath(settings);
+    if (force || !std::filesystem::exists(lutPath))
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<float> lut;
+        bakeBRDFLUT(settings.lutSize, lut);
+
+        if (saveBRDFLUTKTX(lutPath, lut, settings.lutSize))
+            std::cout << lutPath << "  " << settings.lutSize << "x" << settings.lutSize << "  (" << getElapsedMs(start) << " ms)" << std::endl;
+        else
+        {
+            std::cout << "FAILED  " << lutPath << std::endl;
+            failed++;
+        }
+    }
+
+    for (auto& file : files)
+    {
+        // same orientation and content hash as Texture::setTextureHDR, the engine loads the environments flipped
+        HDRImageData image;
+        if (!loadHDRImageData(file, true, image))
+        {
+            std::cout << "FAILED  " << file << std::endl;
+            failed++;
+            continue;
+        }
+
+        uint64_t bakeKey = getIBLBakeKey(image.hash, settings);
+        std::string prefilterPath = getIBLCachePath(bakeKey, "prefilter");
+        std::string cubePath = getIBLCachePath(bakeKey, "cube");
+
+        if (!force && std::filesystem::exists(prefilterPath) && (!writeCube || std::filesystem::exists(cubePath)))
+        {
+            std::cout << "up to date  " << file << std::endl;
+            continue;
+        }
+
+        IrradianceSH irradiance;
+        projectIrradianceSH(image.pixels.data(), image.width, image.height, image.components, irradiance);
+
+        auto start = std::chrono::steady_clock::now();
+        IBLCubeData cube, prefiltered;
+        bakeCubeFromLatlong(image.pixels.data(), image.width, image.height, image.components, settings.cubeSize, cube);
+        image.pixels = std::vector<float>();
+        float cubeTime = getElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<PrefilterLevelReport> report;
+        bakePrefilteredCube(cube, settings.prefilterSize, settings.prefilterLevels, prefiltered, &report);
+        float prefilterTime = getElapsedMs(start);
+
+        bool saved = saveIBLCubeKTX(prefilterPath, prefiltered, settings.prefilterLevels);
+        if (writeCube)
+            saved = saveIBLCubeKTX(cubePath, cube, cube.levels) && saved;
+
+        if (!saved)
+        {
+            std::cout << "FAILED  " << file << std::endl;
+            failed++;
+            continue;
+        }
+
+        std::cout << file << " -> " << prefilterPath << "  (cube " << cubeTime << " ms, prefilter " << prefilterTime << " ms)" << std::endl;
+        for (auto& level : report)
+            std::cout << "    mip " << level.level << "  roughness " << level.roughness << "  " << level.sampleCount << " samples  "
+                      << level.milliseconds << " ms  error " << level.error * 100.0f << " %" << std::endl;
+        std::cout << "    irradiance SH :";
+        for (GLuint i = 0; i < 9 * 3; i++)
+            std::cout << ' ' << irradiance.coefficients[i];
+        std::cout << std::endl;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Offline texture cooker
+// Compresses every image found in the given files / folders to the KTX files the engine loads at runtime,
+// so that shipping builds never pay the import time cooking
+//
+// usage: cookTextures [--hq] [--force] [--usage color|normal|mask] <file or folder>...
+//      --hq        BC7 for the color textures instead of BC1 / BC3
+//      --force     cook again even when the KTX file is up to date
+//      --usage     cook every file for this usage instead of guessing it from the file name. The engine takes the
+//                  usage from the material slot, a normal map named *_bump* needs --usage normal to be found
+//
+// builds from src/tools/cookTextures.cpp with src/resources/image.cpp, blockCompress.cpp, ktx.cpp,
+// textureCooker.cpp, stb_image and glad (no GL context is created)
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+
+#include "image.h"
+#include "blockCompress.h"
+#include "textureCooker.h"
+
+
+static bool isSourceImage(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+    return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
+
+
+int main(int argc, char** argv)
+{
+    bool highQuality = false;
+    bool force = false;
+    bool usageGiven = false;
+    TextureUsage usageOverride = TextureUsage::Color;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "--hq")
+            highQuality = true;
+        else if (argument == "--force")
+            force = true;
+        else if (argument == "--usage" && i + 1 < argc)
+        {
+            std::string usageName = argv[++i];
+            usageGiven = usageName == "color" || usageName == "normal" || usageName == "mask";
+            if (!usageGiven)
+            {
+                std::cout << "unknown usage : " << usageName << std::endl;
+                return 1;
+            }
+            usageOverride = usageName == "normal" ? TextureUsage::Normal : usageName == "mask" ? TextureUsage::Mask : TextureUsage::Color;
+        }
+        else if (std::filesystem::is_directory(argument))
+        {
+            for (auto& entry : std::filesystem::recursive_directory_iterator(argument))
+                if (entry.is_regular_file() && isSourceImage(entry.path()))
+                    files.push_back(entry.path().generic_string());
+        }
+        else
+            files.push_back(argument);
+    }
+
+    if (files.empty())
+    {
+        std::cout << "usage: cookTextures [--hq] [--force] [--usage color|normal|mask] <file or folder>..." << std::endl;
+        return 1;
+    }
+
+    size_t totalSource = 0, totalCooked = 0;
+    int failed = 0;
+
+    for (auto& file : files)
+    {
+        TextureUsage usage = usageGiven ? usageOverride : getUsageFromPath(file);     // the file name hints at the slot the engine loads it for
+        bool colorHighQuality = highQuality && usage == TextureUsage::Color;
+        std::string cookedPath = getCookedPath(file, usage, colorHighQuality);
+
+        if (force)
+            std::filesystem::remove(cookedPath);
+
+        auto start = std::chrono::steady_clock::now();
+        ImageData image;
+        if (!cookTexture(file, usage, image, colorHighQuality))
+        {
+            std::cout << "FAILED  " << file << std::endl;
+            failed++;
+            continue;
+        }
+        float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // uncompressed size of the same chain, RGB is stored as RGBA by the drivers
+        size_t sourceSize = 0;
+        GLuint texelSize = image.components == 3 ? 4 : image.components;
+        for (GLuint level = 0; level < image.getLevelCount(); level++)
+            sourceSize += (size_t)image.getLevelWidth(level) * image.getLevelHeight(level) * texelSize;
+
+        totalSource += sourceSize;
+        totalCooked += image.pixels.size();
+
+        std::cout << cookedPath << "  " << image.width << "x" << image.height << "  "
+                  << sourceSize / 1024 << " KB -> " << image.pixels.size() / 1024 << " KB  (" << elapsed << " ms)" << std::endl;
+    }
+
+    if (totalCooked > 0)
+        std::cout << files.size() - failed << " textures, " << totalSource / 1024 << " KB -> " << totalCooked / 1024 << " KB ("
+                  << (float)totalSource / totalCooked << "x)" << std::endl;
+
+    return failed == 0 ? 0 : 1;
+}